@@ -24,7 +24,7 @@ variations of the "T" command:
 
   <T ID ADDRESS SUBADDRESS>:   creates a new turnout ID, with specified ADDRESS and SUBADDRESS
                                if turnout ID already exists, it is updated with specificed ADDRESS and SUBADDRESS
-                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory)
+                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory, or ADDRESS or SUBADDRESS out of range)
 
   <T ID>:                      deletes definition of turnout ID
                                returns: <O> if successful and <X> if unsuccessful (e.g. ID does not exist)
@@ -64,23 +64,26 @@ the directions of any Turnouts being monitored or controlled by a separate inter
 #include "DCCpp_Uno.h"
 #include "EEStore.h"
 #include <EEPROM.h>
+#include "Events.h"
+#include "Automation.h"
+#include "Messages.h"
 #include "Comm.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Turnout::activate(int s){
-  char c[20];
+void Turnout::activate(int s, int v){
   data.tStatus=(s>0);                                    // if s>0 set turnout=ON, else if zero or negative set turnout=OFF
-  sprintf(c,"a %d %d %d",data.address,data.subAddress,data.tStatus);
-  SerialCommand::parse(c);
+  SerialCommand::mRegs->setAccessory(data.address,data.subAddress,data.tStatus);
   if(num>0)
     EEPROM.put(num,data.tStatus);
-  INTERFACE.print("<H");
-  INTERFACE.print(data.id);
-  if(data.tStatus==0)
-    INTERFACE.print(" 0>");
-  else
-    INTERFACE.print(" 1>"); 
+  if(Events::begin(EVENT_TURNOUT)){
+    Messages::print(INTERFACE,PSTR("H%d %d"),data.id,data.tStatus);
+    Events::end();
+  }
+  Automation::trigger(data.tStatus?AUTOMATION_THROWN:AUTOMATION_UNTHROWN,data.id);
+  if(v==0)
+    return;
+  Messages::print(INTERFACE,PSTR("<H%d %d>"),data.id,data.tStatus);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -98,7 +101,7 @@ void Turnout::remove(int n){
   for(tt=firstTurnout;tt!=NULL && tt->data.id!=n;pp=tt,tt=tt->nextTurnout);
 
   if(tt==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
   
@@ -109,7 +112,7 @@ void Turnout::remove(int n){
 
   free(tt);
 
-  INTERFACE.print("<O>");
+  INTERFACE.print(MSG(MSG_OK));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -118,23 +121,15 @@ void Turnout::show(int n){
   Turnout *tt;
 
   if(firstTurnout==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
     
   for(tt=firstTurnout;tt!=NULL;tt=tt->nextTurnout){
-    INTERFACE.print("<H");
-    INTERFACE.print(tt->data.id);
-    if(n==1){
-      INTERFACE.print(" ");
-      INTERFACE.print(tt->data.address);
-      INTERFACE.print(" ");
-      INTERFACE.print(tt->data.subAddress);
-    }
-    if(tt->data.tStatus==0)
-       INTERFACE.print(" 0>");
-     else
-       INTERFACE.print(" 1>"); 
+    if(n==1)
+      Messages::print(INTERFACE,PSTR("<H%d %d %d %d>"),tt->data.id,tt->data.address,tt->data.subAddress,tt->data.tStatus!=0);
+    else
+      Messages::print(INTERFACE,PSTR("<H%d %d>"),tt->data.id,tt->data.tStatus!=0);
   }
 }
 
@@ -144,18 +139,21 @@ void Turnout::parse(char *c){
   int n,s,m;
   Turnout *t;
   
-  switch(sscanf(c,"%d %d %d",&n,&s,&m)){
+  switch(sscanf_P(c,PSTR("%d %d %d"),&n,&s,&m)){
     
     case 2:                     // argument is string with id number of turnout followed by zero (not thrown) or one (thrown)
       t=get(n);
       if(t!=NULL)
         t->activate(s);
       else
-        INTERFACE.print("<X>");
+        INTERFACE.print(MSG(MSG_FAIL));
       break;
 
     case 3:                     // argument is string with id number of turnout followed by an address and subAddress
-      create(n,s,m,1);
+      if(s<0 || s>511 || m<0 || m>3)
+        INTERFACE.print(MSG(MSG_FAIL));
+      else
+        create(n,s,m,1);
     break;
 
     case 1:                     // argument is a string with id number only
@@ -218,7 +216,7 @@ Turnout *Turnout::create(int id, int add, int subAdd, int v){
 
   if(tt==NULL){       // problem allocating memory
     if(v==1)
-      INTERFACE.print("<X>");
+      INTERFACE.print(MSG(MSG_FAIL));
     return(tt);
   }
   
@@ -227,7 +225,7 @@ Turnout *Turnout::create(int id, int add, int subAdd, int v){
   tt->data.subAddress=subAdd;
   tt->data.tStatus=0;
   if(v==1)
-    INTERFACE.print("<O>");
+    INTERFACE.print(MSG(MSG_OK));
   return(tt);
   
 }
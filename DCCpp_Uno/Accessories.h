@@ -24,7 +24,7 @@ struct Turnout{
   int num;
   struct TurnoutData data;
   Turnout *nextTurnout;
-  void activate(int s);
+  void activate(int s, int=1);
   static void parse(char *c);
   static Turnout* get(int);
   static void remove(int);
@@ -0,0 +1,90 @@
+/**********************************************************************
+
+AckDetector.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+Decoders on the Programming Track acknowledge a CV verify packet by drawing an extra 60 mA or more
+for about 6 milliseconds.  The AckDetector decides whether such a pulse occurred from a series of
+current samples, and stops as soon as the answer is clear rather than always taking the full window:
+
+  * before each verify, baseSample() is fed ACK_BASE_COUNT samples of the idle current, from which arm()
+    learns the baseline mean and its noise, and sets the threshold to ACK_THRESHOLD_SIGMAS standard
+    deviations of the smoothed noise above the baseline (but never lower than ACK_THRESHOLD_MIN)
+
+  * after the verify, sample() is fed current samples one at a time.  It returns 1 (ACKNOWLEDGED) once the
+    exponentially-smoothed current has stayed above the threshold for ACK_CONFIRM_COUNT consecutive samples,
+    0 (NOT ACKNOWLEDGED) if it has not even reached half of the threshold after ACK_QUIET_COUNT samples, or once
+    ACK_SAMPLE_COUNT samples have been taken, and ACK_PENDING otherwise
+
+The detector does not itself read any pins, so the same logic can be replayed against recorded current traces.
+
+**********************************************************************/
+
+#include "AckDetector.h"
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AckDetector::begin(){
+  sum=0;
+  sumSq=0;
+  nBase=0;
+} // AckDetector::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AckDetector::baseSample(int s){
+  sum+=s;
+  sumSq+=(long)s*s;
+  nBase++;
+} // AckDetector::baseSample
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AckDetector::arm(){
+  float sigma;
+
+  c=0;
+  nSamples=0;
+  nAbove=0;
+  rising=false;
+
+  if(nBase<2){                                                            // no baseline available
+    base=0;
+    threshold=ACK_SAMPLE_THRESHOLD;
+    return;
+  }
+
+  base=sum/nBase;
+  sigma=sqrt(max(0.0,(float)sumSq/nBase-(float)sum*sum/((float)nBase*nBase)));
+  sigma*=sqrt(ACK_SAMPLE_SMOOTHING/(2.0-ACK_SAMPLE_SMOOTHING));          // noise remaining after exponential smoothing
+  threshold=max((float)ACK_THRESHOLD_MIN,ACK_THRESHOLD_SIGMAS*sigma);
+} // AckDetector::arm
+
+///////////////////////////////////////////////////////////////////////////////
+
+int AckDetector::sample(int s){
+
+  c=(s-base)*ACK_SAMPLE_SMOOTHING+c*(1.0-ACK_SAMPLE_SMOOTHING);
+  nSamples++;
+
+  if(c>threshold){
+    if(++nAbove>=ACK_CONFIRM_COUNT)                                       // pulse has clearly started
+      return(1);
+  } else{
+    nAbove=0;
+  }
+
+  if(c>threshold/2)
+    rising=true;
+
+  if(nSamples>=ACK_SAMPLE_COUNT || (nSamples>=ACK_QUIET_COUNT && !rising))  // window has ended, or a pulse can no longer be expected
+    return(0);
+
+  return(ACK_PENDING);
+} // AckDetector::sample
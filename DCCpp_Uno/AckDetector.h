@@ -0,0 +1,44 @@
+/**********************************************************************
+
+AckDetector.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef AckDetector_h
+#define AckDetector_h
+
+#include "Arduino.h"
+
+// Define constants used for detecting decoder acknowledgements on the Programming Track
+
+#define  ACK_BASE_COUNT             32      // number of analogRead samples to take before each CV verify to establish a baseline current and noise level
+#define  ACK_SAMPLE_COUNT          500      // maximum number of analogRead samples to take when monitoring current after a CV verify (bit or byte) has been sent
+#define  ACK_SAMPLE_SMOOTHING      0.2      // exponential smoothing to use in processing the analogRead samples after a CV verify (bit or byte) has been sent
+#define  ACK_SAMPLE_THRESHOLD       30      // the threshold used if the baseline noise level cannot be established
+#define  ACK_THRESHOLD_MIN          20      // the lowest threshold that the exponentially-smoothed analogRead samples (after subtracting the baseline current) must cross to establish ACKNOWLEDGEMENT
+#define  ACK_THRESHOLD_SIGMAS        6      // the threshold is otherwise set this many standard deviations of the smoothed baseline noise above the baseline current
+#define  ACK_CONFIRM_COUNT           3      // number of consecutive samples above threshold needed to confirm ACKNOWLEDGEMENT
+#define  ACK_QUIET_COUNT           300      // if smoothed samples have not risen above half of the threshold after this many samples (about 35 ms, past the end of the third verify packet), there is no ACKNOWLEDGEMENT
+
+#define  ACK_PENDING                -1      // returned by AckDetector::sample() while more samples are needed
+
+struct AckDetector{
+  long sum;
+  long sumSq;
+  int nBase;
+  int base;
+  float threshold;
+  float c;
+  int nSamples;
+  byte nAbove;
+  boolean rising;
+  void begin();
+  void baseSample(int);
+  void arm();
+  int sample(int);
+}; // AckDetector
+
+#endif
@@ -0,0 +1,411 @@
+/**********************************************************************
+
+Automation.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION can react to sensors, turnouts, and timers on its own, without waiting for an interface to
+notice a <Q ID> return and send back a <t> or <T> command.  Reactions are defined as HANDLERS, each consisting of
+a TRIGGER and a list of ACTIONS that are carried out, in order, immediately when the trigger occurs --- typically
+within a few hundred microseconds, rather than the tens of milliseconds needed for a round trip through an interface.
+
+Handlers are compiled into a compact byte code as they are defined, kept in SRAM (up to AUTOMATION_MAX_SIZE bytes,
+see Automation.h), and stored in EEPROM along with turnouts, sensors, outputs, and routes using the <E> command.
+
+To define handlers, use the following variations of the "A" command:
+
+  <A TRIGGER ID ACTION ARGS>:  adds ACTION to the end of the list of actions for TRIGGER ID, creating the handler if needed
+                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory, or an argument out of range)
+
+  <A TRIGGER ID>:              deletes the handler for TRIGGER ID
+                               returns: <O> if successful and <X> if unsuccessful (e.g. handler does not exist)
+
+  <A>:                         lists all defined handlers
+                               returns: <A NBYTES NRUNS MAXRUN> followed by <A TRIGGER ID ACTION ARGS> for each action of each handler
+
+where TRIGGER and ID are one of:
+
+  Q ID:    sensor ID becomes active
+  q ID:    sensor ID becomes inactive
+  H ID:    turnout ID is thrown (by any command, route, or handler)
+  h ID:    turnout ID is unthrown
+  W ID:    timer ID (0 through AUTOMATION_TIMERS-1) expires
+
+and ACTION ARGS is one of (each argument must be within the range accepted by the corresponding command --- e.g. REGISTER
+1 through MAX_MAIN_REGISTERS, CAB 0-10293, SPEED -1 to 126, DIRECTION, THROW, and STATE 0 or 1, and timer ID 0 through
+AUTOMATION_TIMERS-1 --- or the action is rejected):
+
+  t REGISTER CAB SPEED DIRECTION:   sets a throttle, as for the <t> command
+  f CAB BYTE1 [BYTE2]:              sets engine decoder functions, as for the <f> command
+  a ADDRESS SUBADDRESS ACTIVATE:    operates a stationary accessory decoder, as for the <a> command
+  T ID THROW:                       throws or unthrows turnout ID, as for the <T> command
+  Z ID STATE:                       sets output ID, as for the <Z> command
+  W ID MS:                          starts timer ID, which will trigger its W handler after MS (0-65535) milliseconds
+  Q ID STATE:                       carries out the remaining actions only if sensor ID is active (STATE=1) or inactive (STATE=0)
+  H ID THROW:                       carries out the remaining actions only if turnout ID is thrown (THROW=1) or unthrown (THROW=0)
+
+and
+
+  NBYTES: the number of bytes of byte code used by all handlers
+  NRUNS: the number of times a handler has been triggered since start-up
+  MAXRUN: the longest time, in microseconds, taken to carry out a handler and any other handlers it triggered
+
+For example, to stop the engine in register 1 (cab 3) when sensor 7 becomes active, unless turnout 2 is thrown,
+and re-start it 5 seconds later:
+
+  <A Q 7 H 2 0>
+  <A Q 7 t 1 3 0 1>
+  <A Q 7 W 0 5000>
+  <A W 0 t 1 3 40 1>
+
+Handlers may trigger other handlers (e.g. a T action triggers any handler for that turnout), up to AUTOMATION_MAX_DEPTH
+deep.  Returns generated by actions (e.g. <H ID THROW>) are sent to every session, including when the handler was triggered
+by a command from a single session.
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Automation.h"
+#include "SerialCommand.h"
+#include "Accessories.h"
+#include "Outputs.h"
+#include "Sensor.h"
+#include "EEStore.h"
+#include "Clock.h"
+#include "Messages.h"
+#include <EEPROM.h>
+#include "Comm.h"
+
+#define  AUTOMATION_INT(p)    ((int)((p)[0]|((p)[1]<<8)))      // byte code stores 16-bit arguments least-significant byte first
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS THE ARGUMENT WIDTHS OF ACTION OP AS A STRING IN FLASH, OR NULL IF OP IS NOT A VALID ACTION
+// EACH ARGUMENT IS '1' (ONE BYTE, 0 TO 255), 's' (ONE SIGNED BYTE, -128 TO 127), OR '2' (TWO BYTES)
+
+const char *Automation::spec(byte op){
+  switch(op){
+    case 't': return(PSTR("12s1"));         // REGISTER CAB SPEED DIRECTION
+    case 'f': return(PSTR("212"));          // CAB BYTE1 BYTE2 (-1 if omitted)
+    case 'a': return(PSTR("211"));          // ADDRESS SUBADDRESS ACTIVATE
+    case 'T': return(PSTR("21"));           // ID THROW
+    case 'Z': return(PSTR("21"));           // ID STATE
+    case 'W': return(PSTR("12"));           // ID MS
+    case 'Q': return(PSTR("21"));           // ID STATE
+    case 'H': return(PSTR("21"));           // ID THROW
+  }
+  return(NULL);
+} // Automation::spec
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS TRUE IF ARGUMENTS A OF ACTION OP ARE WITHIN THE RANGES ACCEPTED BY THE COMMAND IT CARRIES OUT, SO THAT AN ACTION
+// THAT COULD NEVER BE CARRIED OUT IS REJECTED WHEN DEFINED, RATHER THAN SILENTLY IGNORED EACH TIME ITS HANDLER RUNS
+
+boolean Automation::valid(byte op, int *a){
+  switch(op){
+    case 't': return(a[0]>=1 && a[0]<=MAX_MAIN_REGISTERS && a[1]>=0 && a[1]<=10293 && a[2]>=-1 && a[2]<=126 && a[3]<=1);    // as for setThrottle()
+    case 'f': return(a[0]>=0 && a[0]<=10293 && a[2]>=-1 && a[2]<=255);    // as for setFunction() (BYTE2 is -1 if omitted)
+    case 'a': return(a[0]>=0 && a[0]<=511 && a[1]<=3 && a[2]<=1);         // as for setAccessory()
+    case 'T':
+    case 'Z':
+    case 'Q':
+    case 'H': return(a[1]<=1);
+    case 'W': return(a[0]<AUTOMATION_TIMERS);
+  }
+  return(false);
+} // Automation::valid
+
+///////////////////////////////////////////////////////////////////////////////
+
+byte *Automation::find(byte trig, int id){
+  byte *h;
+  for(h=program;h<program+size;h+=AUTOMATION_HEADER+h[3])
+    if(h[0]==trig && AUTOMATION_INT(h+1)==id)
+      return(h);
+  return(NULL);
+} // Automation::find
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::trigger(byte trig, int id){
+  byte *h;
+  unsigned long t;
+  Session *s=Session::current;
+
+  if(size==0 || depth>=AUTOMATION_MAX_DEPTH || (h=find(trig,id))==NULL)
+    return;
+
+  t=Clock::us();
+  depth++;
+  Session::current=NULL;                    // returns generated by actions go to every session, even if a command from one session triggered the handler
+  run(h+AUTOMATION_HEADER,h[3]);
+  Session::current=s;
+  depth--;
+
+  if(depth==0){
+    nRuns++;
+    t=Clock::us()-t;
+    if(t>maxRun)
+      maxRun=t;
+  }
+} // Automation::trigger
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::run(byte *p, byte len){
+  byte *end=p+len;
+  Turnout *t;
+  Output *o;
+  Sensor *s;
+
+  while(p<end){
+    switch(*p++){
+
+      case 't':
+        SerialCommand::mRegs->setThrottle(p[0],AUTOMATION_INT(p+1),(char)p[3],p[4]);
+        p+=5;
+        break;
+
+      case 'f':
+        SerialCommand::mRegs->setFunction(AUTOMATION_INT(p),p[2],AUTOMATION_INT(p+3));
+        p+=5;
+        break;
+
+      case 'a':
+        SerialCommand::mRegs->setAccessory(AUTOMATION_INT(p),p[2],p[3]);
+        p+=4;
+        break;
+
+      case 'T':
+        if((t=Turnout::get(AUTOMATION_INT(p)))!=NULL)
+          t->activate(p[2]);
+        p+=3;
+        break;
+
+      case 'Z':
+        if((o=Output::get(AUTOMATION_INT(p)))!=NULL)
+          o->activate(p[2]);
+        p+=3;
+        break;
+
+      case 'W':
+        if(p[0]<AUTOMATION_TIMERS){
+          timer[p[0]].duration=AUTOMATION_INT(p+1);
+          timer[p[0]].startTime=Clock::ms();
+          timer[p[0]].active=true;
+        }
+        p+=3;
+        break;
+
+      case 'Q':
+        if((s=Sensor::get(AUTOMATION_INT(p)))==NULL || s->active!=(p[2]>0))
+          return;
+        p+=3;
+        break;
+
+      case 'H':
+        if((t=Turnout::get(AUTOMATION_INT(p)))==NULL || t->data.tStatus!=(p[2]>0))
+          return;
+        p+=3;
+        break;
+
+      default:                              // invalid byte code --- stop rather than guess
+        return;
+    }
+  }
+} // Automation::run
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::check(){
+  for(int i=0;i<AUTOMATION_TIMERS;i++){
+    if(timer[i].active && Clock::ms()-timer[i].startTime>=timer[i].duration){
+      timer[i].active=false;
+      trigger(AUTOMATION_TIMER,i);
+    }
+  }
+} // Automation::check
+
+///////////////////////////////////////////////////////////////////////////////
+
+// COMPILES ACTION S (E.G. "t 1 3 0 1") AND APPENDS IT TO THE HANDLER FOR TRIGGER ID
+
+void Automation::add(byte trig, int id, char *s){
+  const char *w;
+  int a[4];
+  int n, nArgs, offset;
+  byte code[8];
+  byte nCode=0;
+  byte *h, *end;
+
+  if((w=spec(s[0]))==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  nArgs=strlen_P(w);
+  n=sscanf_P(s+1,PSTR("%d %d %d %d"),a,a+1,a+2,a+3);
+  if(s[0]=='f' && n==2)                     // BYTE2 omitted
+    a[n++]=-1;
+
+  if(n!=nArgs){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  code[nCode++]=s[0];
+  for(int i=0;i<nArgs;i++){
+    if((pgm_read_byte(w+i)=='1' && (a[i]<0 || a[i]>255)) || (pgm_read_byte(w+i)=='s' && (a[i]<-128 || a[i]>127))){
+      INTERFACE.print(MSG(MSG_FAIL));       // argument does not fit in its byte
+      return;
+    }
+    code[nCode++]=lowByte(a[i]);
+    if(pgm_read_byte(w+i)=='2')
+      code[nCode++]=highByte(a[i]);
+  }
+
+  if(!valid(s[0],a)){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  h=find(trig,id);
+  offset=(h==NULL)?size:h-program;
+  n=nCode+((h==NULL)?AUTOMATION_HEADER:0);  // number of bytes to add
+
+  if(size+n>AUTOMATION_MAX_SIZE || (h!=NULL && h[3]+nCode>255) || (h=(byte *)realloc(program,size+n))==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  program=h;
+  h=program+offset;
+
+  if(offset==size){                         // new handler
+    h[0]=trig;
+    h[1]=lowByte(id);
+    h[2]=highByte(id);
+    h[3]=0;
+    size+=AUTOMATION_HEADER;
+  }
+
+  end=h+AUTOMATION_HEADER+h[3];
+  memmove(end+nCode,end,program+size-end);  // make room for new action at end of handler
+  memcpy(end,code,nCode);
+  h[3]+=nCode;
+  size+=nCode;
+
+  INTERFACE.print(MSG(MSG_OK));
+} // Automation::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::remove(byte trig, int id){
+  byte *h;
+  int n;
+
+  if((h=find(trig,id))==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  n=AUTOMATION_HEADER+h[3];
+  memmove(h,h+n,program+size-(h+n));
+  size-=n;
+
+  INTERFACE.print(MSG(MSG_OK));
+} // Automation::remove
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::show(){
+  byte *h, *p;
+  const char *w;
+
+  Messages::print(INTERFACE,PSTR("<A%d %L %L>"),size,nRuns,maxRun);
+
+  for(h=program;h<program+size;h+=AUTOMATION_HEADER+h[3]){
+    for(p=h+AUTOMATION_HEADER;p<h+AUTOMATION_HEADER+h[3] && (w=spec(*p))!=NULL;){
+      Messages::print(INTERFACE,PSTR("<A%c %d %c"),h[0],AUTOMATION_INT(h+1),*p++);
+      for(;pgm_read_byte(w)!='\0';w++){
+        if(pgm_read_byte(w)=='2'){
+          Messages::print(INTERFACE,PSTR(" %d"),AUTOMATION_INT(p));
+          p+=2;
+        } else if(pgm_read_byte(w)=='s'){
+          Messages::print(INTERFACE,PSTR(" %d"),(char)*p++);
+        } else{
+          Messages::print(INTERFACE,PSTR(" %d"),*p++);
+        }
+      }
+      INTERFACE.print('>');
+    }
+  }
+} // Automation::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::parse(char *c){
+  byte trig;
+  int id;
+  char *s;
+
+  while(*c==' ')
+    c++;
+
+  if(*c=='\0'){                 // no arguments
+    show();
+    return;
+  }
+
+  trig=*c++;
+  id=strtol(c,&s,10);
+
+  if((trig!=AUTOMATION_SENSOR_ON && trig!=AUTOMATION_SENSOR_OFF && trig!=AUTOMATION_THROWN && trig!=AUTOMATION_UNTHROWN && trig!=AUTOMATION_TIMER) || s==c){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  while(*s==' ')
+    s++;
+
+  if(*s=='\0')                  // argument is trigger and id only
+    remove(trig,id);
+  else                          // argument is trigger and id followed by an action
+    add(trig,id,s);
+} // Automation::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::load(){
+  size=0;
+  if(EEStore::eeStore->data.nAutomation<=0 || EEStore::eeStore->data.nAutomation>AUTOMATION_MAX_SIZE || (program=(byte *)malloc(EEStore::eeStore->data.nAutomation))==NULL)
+    return;
+
+  size=EEStore::eeStore->data.nAutomation;
+  for(int i=0;i<size;i++)
+    program[i]=EEPROM.read(EEStore::pointer()+i);
+  EEStore::advance(size);
+} // Automation::load
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Automation::store(){
+  for(int i=0;i<size;i++)
+    EEPROM.update(EEStore::pointer()+i,program[i]);
+  EEStore::advance(size);
+  EEStore::eeStore->data.nAutomation=size;
+} // Automation::store
+
+///////////////////////////////////////////////////////////////////////////////
+
+byte *Automation::program=NULL;
+int Automation::size=0;
+byte Automation::depth=0;
+AutomationTimer Automation::timer[AUTOMATION_TIMERS];
+unsigned long Automation::nRuns=0;
+unsigned long Automation::maxRun=0;
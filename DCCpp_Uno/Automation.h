@@ -0,0 +1,60 @@
+/**********************************************************************
+
+Automation.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Automation_h
+#define Automation_h
+
+#include "Arduino.h"
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  AUTOMATION_MAX_SIZE        128       // maximum number of bytes of automation program
+#else                                         // Configuration for MEGA
+  #define  AUTOMATION_MAX_SIZE        1024
+#endif
+
+#define  AUTOMATION_TIMERS            4         // number of timers that can be started by automation handlers
+#define  AUTOMATION_MAX_DEPTH         4         // maximum nesting of handlers triggered by other handlers (e.g. by throwing a turnout)
+#define  AUTOMATION_HEADER            4         // bytes at start of each handler: TRIGGER, ID (2 bytes), LENGTH
+#define  AUTOMATION_CHECK_TIME        1000      // microseconds between checks of timers
+#define  AUTOMATION_CHECK_BUDGET      300       // microseconds expected to check timers and run any handler triggered (see Scheduler.h)
+
+#define  AUTOMATION_SENSOR_ON         'Q'       // triggers
+#define  AUTOMATION_SENSOR_OFF        'q'
+#define  AUTOMATION_THROWN            'H'
+#define  AUTOMATION_UNTHROWN          'h'
+#define  AUTOMATION_TIMER             'W'
+
+struct AutomationTimer{
+  boolean active;
+  unsigned int duration;
+  unsigned long startTime;
+};
+
+struct Automation{
+  static byte *program;
+  static int size;
+  static byte depth;
+  static AutomationTimer timer[AUTOMATION_TIMERS];
+  static unsigned long nRuns;
+  static unsigned long maxRun;
+  static void trigger(byte, int);
+  static void run(byte *, byte);
+  static void check();
+  static const char *spec(byte);
+  static boolean valid(byte, int *);
+  static byte *find(byte, int);
+  static void add(byte, int, char *);
+  static void remove(byte, int);
+  static void show();
+  static void parse(char *c);
+  static void load();
+  static void store();
+}; // Automation
+
+#endif
@@ -0,0 +1,295 @@
+/**********************************************************************
+
+BinaryCommand.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+In addition to text commands of the form <...>, DCC++ BASE STATION accepts a compact BINARY form of the most
+frequently-used commands on the same interface.  This is intended for interfaces that send many throttle
+updates per second, where each binary command takes about a third of the bytes of its text equivalent and
+needs no sscanf() parsing.  Text and binary commands may be freely mixed.
+
+Each binary frame, in either direction, has the form:
+
+  START LENGTH OPCODE PAYLOAD... CRC
+
+where
+
+  START: 0xA5, a byte that never appears in text commands
+  LENGTH: the number of bytes in OPCODE and PAYLOAD (1-16 for received frames)
+  OPCODE: the command (see below) --- replies use the same OPCODE plus 0x80
+  PAYLOAD: zero or more fields --- 16-bit fields are sent least-significant byte first
+  CRC: CRC-8 (polynomial 0x07, initial value 0) computed over LENGTH, OPCODE, and PAYLOAD
+
+A frame that is not completed within BINARY_FRAME_TIMEOUT milliseconds is discarded.
+
+The following OPCODES are supported (I16 = 16-bit signed integer, U8 = byte), with the text command each is equivalent to:
+
+  0x01 THROTTLE:   REGISTER(U8) CAB(I16) SPEED(U8, 0-126 or 0xFF for emergency stop) DIRECTION(U8)    <t REGISTER CAB SPEED DIRECTION>
+                   returns: 0x81 REGISTER(U8) SPEED(U8) DIRECTION(U8)
+
+  0x02 FUNCTION:   CAB(I16) BYTE1(U8) [BYTE2(U8)]                                                   <f CAB BYTE1 [BYTE2]>
+                   returns: nothing (BYTE1 must be 128-191 without BYTE2, or 222-223 with BYTE2)
+
+  0x03 ACCESSORY:  ADDRESS(I16) SUBADDRESS(U8) ACTIVATE(U8)                                         <a ADDRESS SUBADDRESS ACTIVATE>
+                   returns: nothing
+
+  0x04 TURNOUT:    ID(I16) THROW(U8)                                                                <T ID THROW>
+                   returns: 0x84 ID(I16) THROW(U8)
+
+  0x05 OUTPUT:     ID(I16) STATE(U8)                                                                <Z ID STATE>
+                   returns: 0x85 ID(I16) STATE(U8)
+
+  0x06 SENSORS:    (no payload)                                                                     <Q>
+                   returns: 0x86 followed by ID(I16) STATE(U8) for each defined sensor (STATE: 1=active, 0=not active)
+
+  0x07 POWER:      ON(U8)                                                                           <1> or <0>
+                   returns: 0x87 ON(U8)
+
+If a frame cannot be processed, the following is returned instead:
+
+  0xFF OPCODE(U8) ERROR(U8)
+
+where ERROR is 1 (bad CRC), 2 (unknown OPCODE), 3 (wrong LENGTH for OPCODE), or 4 (invalid REGISTER, CAB, SPEED, DIRECTION, BYTE1,
+ADDRESS, SUBADDRESS, or ACTIVATE, or undefined turnout or output ID).
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "BinaryCommand.h"
+#include "SerialCommand.h"
+#include "Accessories.h"
+#include "Outputs.h"
+#include "Sensor.h"
+#include "Counters.h"
+#include "Clock.h"
+#include "Events.h"
+#include "Recorder.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS TRUE IF BYTE C WAS CONSUMED AS PART OF A BINARY FRAME, OR FALSE IF IT SHOULD BE PROCESSED AS PART OF A TEXT COMMAND
+
+boolean BinaryCommand::receive(byte c){
+
+  if(state!=BINARY_IDLE && Clock::ms()-startTime>BINARY_FRAME_TIMEOUT)     // discard incomplete frame
+    state=BINARY_IDLE;
+
+  switch(state){
+
+    case BINARY_IDLE:
+      if(c!=BINARY_START)
+        return(false);
+      startTime=Clock::ms();
+      state=BINARY_LENGTH;
+    break;
+
+    case BINARY_LENGTH:
+      if(c==0 || c>BINARY_MAX_LENGTH){
+        state=BINARY_IDLE;
+        Counters::nParseErrors++;
+        error(0,BINARY_ERR_LENGTH);
+        break;
+      }
+      length=c;
+      nBytes=0;
+      crc=crc8(0,c);
+      state=BINARY_DATA;
+    break;
+
+    case BINARY_DATA:
+      buf[nBytes++]=c;
+      crc=crc8(crc,c);
+      if(nBytes==length)
+        state=BINARY_CRC;
+    break;
+
+    case BINARY_CRC:
+      state=BINARY_IDLE;
+      Counters::nCommands++;
+      if(c!=crc){
+        Counters::nParseErrors++;
+        error(buf[0],BINARY_ERR_CRC);
+      } else{
+        execute();
+      }
+    break;
+  }
+
+  return(true);
+} // BinaryCommand::receive
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::execute(){
+  byte *p=buf+1;
+  byte n=length-1;                          // number of payload bytes
+  Turnout *t;
+  Output *o;
+  Sensor *s;
+
+  Recorder::binary(buf,length);             // record command, if recording is in progress (see Recorder.cpp)
+
+  switch(buf[0]){
+
+    case BINARY_THROTTLE:
+      if(n!=5)
+        break;
+      if(SerialCommand::mRegs->setThrottle(p[0],getInt(p+1),(p[3]==0xFF)?-1:p[3],p[4]>0)!=0){
+        error(buf[0],BINARY_ERR_INVALID);
+        return;
+      }
+      beginReply(BINARY_THROTTLE,3);
+      replyByte(p[0]);
+      replyByte((p[3]==0xFF)?0:p[3]);
+      replyByte(p[4]>0);
+      endReply();
+      return;
+
+    case BINARY_FUNCTION:
+      if(n!=3 && n!=4)
+        break;
+      if((n==3)?(p[2]<0x80 || p[2]>0xBF):(p[2]!=0xDE && p[2]!=0xDF)){      // BYTE1 must be 10XXXXXX (FL,F1-F12), or 0xDE or 0xDF (F13-F28)
+        error(buf[0],BINARY_ERR_INVALID);
+        return;
+      }
+      if(SerialCommand::mRegs->setFunction(getInt(p),p[2],(n==3)?-1:p[3])!=0)
+        error(buf[0],BINARY_ERR_INVALID);
+      return;
+
+    case BINARY_ACCESSORY:
+      if(n!=4)
+        break;
+      if(SerialCommand::mRegs->setAccessory(getInt(p),p[2],p[3])!=0)
+        error(buf[0],BINARY_ERR_INVALID);
+      return;
+
+    case BINARY_TURNOUT:
+      if(n!=3)
+        break;
+      if((t=Turnout::get(getInt(p)))==NULL){
+        error(buf[0],BINARY_ERR_INVALID);
+        return;
+      }
+      t->activate(p[2],0);
+      beginReply(BINARY_TURNOUT,4);
+      replyInt(t->data.id);
+      replyByte(t->data.tStatus);
+      endReply();
+      return;
+
+    case BINARY_OUTPUT:
+      if(n!=3)
+        break;
+      if((o=Output::get(getInt(p)))==NULL){
+        error(buf[0],BINARY_ERR_INVALID);
+        return;
+      }
+      o->activate(p[2],0);
+      beginReply(BINARY_OUTPUT,4);
+      replyInt(o->data.id);
+      replyByte(o->data.oStatus);
+      endReply();
+      return;
+
+    case BINARY_SENSORS:
+      if(n!=0)
+        break;
+      n=0;
+      for(s=Sensor::firstSensor;s!=NULL && n<84;s=s->nextSensor)     // at most 84 sensors fit in one reply
+        n++;
+      beginReply(BINARY_SENSORS,1+n*3);
+      for(s=Sensor::firstSensor;n>0;s=s->nextSensor,n--){
+        replyInt(s->data.snum);
+        replyByte(s->active);
+      }
+      endReply();
+      return;
+
+    case BINARY_POWER:
+      if(n!=1)
+        break;
+      SerialCommand::pMonitor->power(p[0]);
+      for(int i=0;i<=MAIN_DISTRICTS;i++)
+        SerialCommand::mMonitor[i].power(p[0]);
+      Events::message(EVENT_POWER,p[0]?MSG_POWER_ON:MSG_POWER_OFF);
+      beginReply(BINARY_POWER,2);
+      replyByte(p[0]>0);
+      endReply();
+      return;
+
+    default:
+      Counters::nParseErrors++;
+      error(buf[0],BINARY_ERR_OPCODE);
+      return;
+  }
+
+  Counters::nParseErrors++;                     // payload was wrong length for opcode
+  error(buf[0],BINARY_ERR_LENGTH);
+} // BinaryCommand::execute
+
+///////////////////////////////////////////////////////////////////////////////
+
+byte BinaryCommand::crc8(byte crc, byte c){     // CRC-8 with polynomial x^8+x^2+x+1 (0x07)
+  crc^=c;
+  for(byte i=0;i<8;i++)
+    crc=(crc&0x80)?(crc<<1)^0x07:(crc<<1);
+  return(crc);
+} // BinaryCommand::crc8
+
+///////////////////////////////////////////////////////////////////////////////
+
+int BinaryCommand::getInt(byte *p){
+  return(p[0]+(p[1]<<8));
+} // BinaryCommand::getInt
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::beginReply(byte opcode, byte length){
+  INTERFACE.write(BINARY_START);
+  txCrc=0;
+  replyByte(length);
+  replyByte(opcode+BINARY_REPLY);
+} // BinaryCommand::beginReply
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::replyByte(byte c){
+  INTERFACE.write(c);
+  txCrc=crc8(txCrc,c);
+} // BinaryCommand::replyByte
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::replyInt(int n){
+  replyByte(lowByte(n));
+  replyByte(highByte(n));
+} // BinaryCommand::replyInt
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::endReply(){
+  INTERFACE.write(txCrc);
+} // BinaryCommand::endReply
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryCommand::error(byte opcode, byte err){
+  INTERFACE.write(BINARY_START);
+  txCrc=0;
+  replyByte(3);
+  replyByte(BINARY_ERROR);
+  replyByte(opcode);
+  replyByte(err);
+  endReply();
+} // BinaryCommand::error
+
+///////////////////////////////////////////////////////////////////////////////
+
+byte BinaryCommand::txCrc;
@@ -0,0 +1,58 @@
+/**********************************************************************
+
+BinaryCommand.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef BinaryCommand_h
+#define BinaryCommand_h
+
+#include "Arduino.h"
+
+#define  BINARY_START             0xA5      // first byte of every binary frame --- never used in text commands
+#define  BINARY_MAX_LENGTH        16        // maximum number of opcode and payload bytes in a received frame
+#define  BINARY_FRAME_TIMEOUT     50        // milliseconds after which an incomplete frame is discarded
+
+#define  BINARY_THROTTLE          0x01
+#define  BINARY_FUNCTION          0x02
+#define  BINARY_ACCESSORY         0x03
+#define  BINARY_TURNOUT           0x04
+#define  BINARY_OUTPUT            0x05
+#define  BINARY_SENSORS           0x06
+#define  BINARY_POWER             0x07
+#define  BINARY_REPLY             0x80      // added to opcode of each reply
+#define  BINARY_ERROR             0xFF
+
+#define  BINARY_IDLE              0         // receive states
+#define  BINARY_LENGTH            1
+#define  BINARY_DATA              2
+#define  BINARY_CRC               3
+
+#define  BINARY_ERR_CRC           1
+#define  BINARY_ERR_OPCODE        2
+#define  BINARY_ERR_LENGTH        3
+#define  BINARY_ERR_INVALID       4
+
+struct BinaryCommand{                       // each Session assembles binary frames in its own BinaryCommand (see Session.h)
+  byte buf[BINARY_MAX_LENGTH];
+  byte state;
+  byte length;
+  byte nBytes;
+  byte crc;
+  unsigned long startTime;
+  static byte txCrc;
+  boolean receive(byte);
+  void execute();
+  static byte crc8(byte, byte);
+  static int getInt(byte *);
+  static void beginReply(byte, byte);
+  static void replyByte(byte);
+  static void replyInt(int);
+  static void endReply();
+  static void error(byte, byte);
+}; // BinaryCommand
+
+#endif
@@ -0,0 +1,94 @@
+/**********************************************************************
+
+Clock.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION re-purposes Timer 0 on the Uno to generate the DCC signal for the Programming Track.
+This changes the rate at which the Arduino's millis() and micros() functions advance (approximately 8 times
+faster), whereas on the Mega, which uses Timer 3 instead, they are unaffected.
+
+To provide a single timebase with the same meaning on both boards, the Clock uses otherwise-unused Timer 2
+as a free-running counter with a prescale of 8, giving a resolution of 0.5 microseconds.  An interrupt on each
+overflow (every 128 microseconds) extends the 8-bit counter in software.
+
+  Clock::us():   microseconds since start-up (wraps around after approximately 71 minutes)
+  Clock::ms():   milliseconds since start-up (wraps around after approximately 49 days)
+
+As with millis(), intervals should always be computed by subtracting two unsigned readings, which gives the correct
+result across a wrap-around.
+
+Since Timer 2 is no longer available for PWM, analogWrite() cannot be used on pins 3 and 11 (Uno) or pins 9 and 10 (Mega),
+and tone() cannot be used.  The motor shield enable pins on these boards are only ever set with digitalWrite(),
+which is unaffected.
+
+**********************************************************************/
+
+#include "Clock.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Clock::begin(){
+
+  TCCR2A=0;                 // set Timer 2 to NORMAL mode, with no output on OC2A or OC2B
+  TCCR2B=0;
+  TCNT2=0;
+
+  bitClear(TCCR2B,CS22);    // set Timer 2 prescale=8
+  bitSet(TCCR2B,CS21);
+  bitClear(TCCR2B,CS20);
+
+  bitSet(TIMSK2,TOIE2);     // enable interrupt vector for Timer 2 Overflow
+  
+} // Clock::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned long Clock::us(){
+  unsigned long n;
+  byte t;
+  byte oldSREG=SREG;
+
+  cli();
+  n=overflows;
+  t=TCNT2;
+  if(bitRead(TIFR2,TOV2) && t<255)     // counter has overflowed but interrupt has not yet been serviced
+    n++;
+  SREG=oldSREG;
+
+  return(n*CLOCK_OVERFLOW_MICROS+(t>>1));
+} // Clock::us
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned long Clock::ms(){
+  unsigned long n;
+  byte oldSREG=SREG;
+
+  cli();
+  n=millisCount;
+  SREG=oldSREG;
+
+  return(n);
+} // Clock::ms
+
+///////////////////////////////////////////////////////////////////////////////
+
+ISR(TIMER2_OVF_vect){
+  Clock::overflows++;
+  Clock::millisFract+=CLOCK_OVERFLOW_MICROS;
+  if(Clock::millisFract>=1000){
+    Clock::millisFract-=1000;
+    Clock::millisCount++;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+volatile unsigned long Clock::overflows=0;
+volatile unsigned long Clock::millisCount=0;
+volatile unsigned int Clock::millisFract=0;
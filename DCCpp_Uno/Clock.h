@@ -0,0 +1,28 @@
+/**********************************************************************
+
+Clock.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Clock_h
+#define Clock_h
+
+#include "Arduino.h"
+
+// Timer 2 is run with a prescale of 8 (0.5 microseconds per tick) and overflows every 256 ticks
+
+#define  CLOCK_OVERFLOW_MICROS     128      // microseconds between Timer 2 overflows
+
+struct Clock{
+  static volatile unsigned long overflows;
+  static volatile unsigned long millisCount;
+  static volatile unsigned int millisFract;
+  static void begin();
+  static unsigned long us();
+  static unsigned long ms();
+}; // Clock
+
+#endif
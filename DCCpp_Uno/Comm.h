@@ -16,20 +16,34 @@ Part of DCC++ BASE STATION for the Arduino
   #if COMM_INTERFACE == 1
     #define COMM_SHIELD_NAME      "ARDUINO-CC ETHERNET SHIELD (WIZNET 5100)"
     #include <Ethernet.h>         // built-in Arduino.cc library
+    #ifdef UDP_PORT
+      #include <EthernetUdp.h>
+    #endif
 
   #elif COMM_INTERFACE == 2
     #define COMM_SHIELD_NAME      "ARDUINO-ORG ETHERNET-2 SHIELD (WIZNET 5500)"
     #include <Ethernet2.h>        // https://github.com/arduino-org/Arduino
+    #ifdef UDP_PORT
+      #include <EthernetUdp2.h>
+    #endif
 
   #elif COMM_INTERFACE == 3
     #define COMM_SHIELD_NAME      "SEEED STUDIO ETHERNET SHIELD (WIZNET 5200)"
     #include <EthernetV2_0.h>     // https://github.com/Seeed-Studio/Ethernet_Shield_W5200
+    #ifdef UDP_PORT
+      #include <EthernetUdpV2_0.h>
+    #endif
 
   #endif
 
-  extern EthernetServer INTERFACE;
+  extern EthernetServer COMM_PORT;
+  #ifdef UDP_PORT
+    extern EthernetUDP COMM_UDP;
+  #endif
 #endif  
 
+#include "Session.h"
+
 
 
 
@@ -17,6 +17,31 @@ Part of DCC++ BASE STATION for the Arduino
 
 #define MOTOR_SHIELD_TYPE   0
 
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINE CURRENT LIMITS (IN MILLIAMPS) ABOVE WHICH THE MAIN OPERATIONS TRACK AND PROGRAMMING TRACK ARE EACH SEPARATELY SHUT OFF *OR*
+// COMMENT OUT TO USE THE DEFAULT FOR THE MOTOR SHIELD SELECTED ABOVE (ABOUT 890 FOR TYPES 0 AND 2, ABOUT 2790 FOR TYPE 1), WHICH IS THE
+// SAME CURRENT AT WHICH EARLIER VERSIONS SHUT OFF BOTH TRACKS.  A LOWER PROGRAMMING TRACK LIMIT (E.G. 250) BETTER PROTECTS A DECODER WITH A FAULT.
+// AN OVERLOADED TRACK IS AUTOMATICALLY RE-TRIED WITH INCREASING DELAYS (SEE CurrentMonitor.h)
+// LIMITS ABOVE WHAT THE MOTOR SHIELD CAN MEASURE (ABOUT 3000 FOR TYPES 0 AND 2, ABOUT 9500 FOR TYPE 1) ARE REDUCED TO THE LARGEST MEASURABLE CURRENT
+
+//#define CURRENT_LIMIT_MAIN  900
+//#define CURRENT_LIMIT_PROG  250
+
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINE NUMBER OF ADDITIONAL MAIN OPERATIONS TRACK POWER DISTRICTS (0 = MOTOR SHIELD CHANNEL A ONLY)
+//
+// EACH ADDITIONAL DISTRICT IS A BOOSTER (OR SPARE MOTOR DRIVER) WHOSE DIRECTION INPUT IS WIRED TO DCC_SIGNAL_PIN_MAIN, SO THAT ALL
+// DISTRICTS CARRY THE SAME MAIN TRACK PACKETS, BUT WITH ITS OWN ENABLE PIN, CURRENT SENSE PIN, AND CURRENT LIMIT (IN MILLIAMPS).
+// AN OVERLOAD SHUTS OFF ONLY THE DISTRICT CONCERNED (SEE CurrentMonitor.cpp).  LIST ONE {CURRENT SENSE PIN, ENABLE PIN, LIMIT}
+// ENTRY PER ADDITIONAL DISTRICT, E.G.:
+//
+//  #define MAIN_DISTRICTS      2
+//  #define MAIN_DISTRICT_LIST  {A2,5,900}, {A3,6,900}
+
+#define MAIN_DISTRICTS  0
+
 /////////////////////////////////////////////////////////////////////////////////////
 //
 // DEFINE NUMBER OF MAIN TRACK REGISTER
@@ -34,6 +59,16 @@ Part of DCC++ BASE STATION for the Arduino
 
 #define COMM_INTERFACE   0
 
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINE ADDITIONAL HARDWARE SERIAL PORTS (MEGA ONLY) ON WHICH TO ACCEPT COMMANDS AT THE SAME TIME AS THE INTERFACE ABOVE
+//
+//  Sum of: 1 = Serial1, 2 = Serial2, 4 = Serial3  (e.g. 5 = Serial1 and Serial3), or 0 = none
+//
+
+#define SERIAL_PORTS   0
+#define SERIAL_PORTS_BAUD  115200
+
 /////////////////////////////////////////////////////////////////////////////////////
 //
 // DEFINE STATIC IP ADDRESS *OR* COMMENT OUT TO USE DHCP
@@ -48,6 +83,13 @@ Part of DCC++ BASE STATION for the Arduino
 
 #define ETHERNET_PORT 2560
 
+/////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINE PORT TO USE FOR UDP DATAGRAMS (ETHERNET COMMUNICATIONS INTERFACE ONLY) *OR* COMMENT OUT TO DISABLE
+//
+
+//#define UDP_PORT 2561
+
 /////////////////////////////////////////////////////////////////////////////////////
 //
 // DEFINE MAC ADDRESS ARRAY FOR ETHERNET COMMUNICATIONS INTERFACE
@@ -56,3 +98,11 @@ Part of DCC++ BASE STATION for the Arduino
 #define MAC_ADDRESS {  0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xEF }
 
 /////////////////////////////////////////////////////////////////////////////////////
+//
+// DEFINE MINIMUM TIME (IN MILLISECONDS) BETWEEN SUCCESSIVE TURNOUT ACTIVATIONS WHEN FIRING A ROUTE
+// INCREASE IF SOLENOID POWER SUPPLY OR CAPACITIVE DISCHARGE UNIT NEEDS MORE TIME TO RECHARGE
+//
+
+#define ROUTE_PACE_TIME 100
+
+/////////////////////////////////////////////////////////////////////////////////////
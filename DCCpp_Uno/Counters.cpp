@@ -0,0 +1,166 @@
+/**********************************************************************
+
+Counters.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION keeps a small set of performance counters, updated with simple increments by the
+DCC signal interrupts, the Packet Registers, the command parser, and the main loop, to help identify
+which part of the sketch is saturated on a busy layout.
+
+To read or reset the counters use:
+
+  <G>:          returns a snapshot of all counters
+                returns: <G LOOPS MAXLOOP COMMANDS ERRORS TXSTALLS|MAIN_INTS MAIN_PACKETS MAIN_LOADS MAIN_WAITS MAIN_WAITTIME MAIN_OVERRUNS MAIN_OVERRUNREG MAIN_OVERRUNBIT|PROG_INTS ... PROG_OVERRUNBIT|N0 N1 ... NMAX>
+
+  <G 0>:        resets all counters to zero
+                returns: <O>
+
+where
+
+  LOOPS: the number of passes through the main loop
+  MAXLOOP: the longest single pass through the main loop, in microseconds
+  COMMANDS: the number of commands received
+  ERRORS: the number of commands that were not recognized
+  TXSTALLS: the number of times buffered replies did not fit in the serial transmit buffer, so that output had to wait
+  INTS: the number of DCC signal interrupts (one per DCC bit) on the Main or Programming Track
+  PACKETS: the number of DCC packets transmitted on the Main or Programming Track
+  LOADS: the number of packets loaded into the Main or Programming Track registers
+  WAITS: the number of those loads that had to wait for a prior packet to be picked up by the DCC signal interrupt
+  WAITTIME: the total time spent waiting, in microseconds
+  OVERRUNS: the number of DCC signal interrupts that occured too late to set the next DCC bit in time, causing a bit to be repeated
+  OVERRUNREG, OVERRUNBIT: the register, and bit within its packet, that was being transmitted at the time of the most recent overrun
+  N0 ... NMAX: the number of packets transmitted from each Main Track register (register 0 holds one-time packets)
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Counters.h"
+#include "PacketRegister.h"
+#include "SerialCommand.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Counters::loop(unsigned long t){
+  nLoops++;
+  if(t>maxLoop)
+    maxLoop=t;
+} // Counters::loop
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Counters::parse(char *c){
+  int n;
+
+  switch(sscanf_P(c,PSTR("%d"),&n)){
+
+    case 1:                     // argument is zero
+      if(n==0){
+        reset();
+        INTERFACE.print(MSG(MSG_OK));
+      } else{
+        INTERFACE.print(MSG(MSG_FAIL));
+      }
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+  }
+} // Counters::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Counters::show(){
+  volatile RegisterList *regs[2]={SerialCommand::mRegs,SerialCommand::pRegs};
+  unsigned long nInterrupts, nPackets;
+  unsigned int nSent, nOverruns;
+  byte overrunReg, overrunBit;
+
+  INTERFACE.print(F("<G"));
+  INTERFACE.print(nLoops);
+  INTERFACE.print(' ');
+  INTERFACE.print(maxLoop);
+  INTERFACE.print(' ');
+  INTERFACE.print(nCommands);
+  INTERFACE.print(' ');
+  INTERFACE.print(nParseErrors);
+  INTERFACE.print(' ');
+  INTERFACE.print(nTxStalls);
+
+  for(int i=0;i<2;i++){
+    noInterrupts();                               // counters are updated by DCC signal interrupt
+    nInterrupts=regs[i]->nInterrupts;
+    nPackets=regs[i]->nPackets;
+    nOverruns=regs[i]->nOverruns;
+    overrunReg=regs[i]->overrunReg;
+    overrunBit=regs[i]->overrunBit;
+    interrupts();
+    INTERFACE.print('|');
+    INTERFACE.print(nInterrupts);
+    INTERFACE.print(' ');
+    INTERFACE.print(nPackets);
+    INTERFACE.print(' ');
+    INTERFACE.print(regs[i]->nLoads);
+    INTERFACE.print(' ');
+    INTERFACE.print(regs[i]->nLoadWaits);
+    INTERFACE.print(' ');
+    INTERFACE.print(regs[i]->loadWaitTime);
+    INTERFACE.print(' ');
+    INTERFACE.print(nOverruns);
+    INTERFACE.print(' ');
+    INTERFACE.print(overrunReg);
+    INTERFACE.print(' ');
+    INTERFACE.print(overrunBit);
+  }
+
+  INTERFACE.print('|');
+  for(int i=0;i<=regs[0]->maxNumRegs;i++){
+    noInterrupts();
+    nSent=regs[0]->reg[i].nSent;
+    interrupts();
+    if(i>0)
+      INTERFACE.print(' ');
+    INTERFACE.print(nSent);
+  }
+  INTERFACE.print('>');
+} // Counters::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Counters::reset(){
+  volatile RegisterList *regs[2]={SerialCommand::mRegs,SerialCommand::pRegs};
+
+  nLoops=0;
+  maxLoop=0;
+  nCommands=0;
+  nParseErrors=0;
+  nTxStalls=0;
+
+  for(int i=0;i<2;i++){
+    noInterrupts();
+    regs[i]->nInterrupts=0;
+    regs[i]->nPackets=0;
+    regs[i]->nOverruns=0;
+    for(int j=0;j<=regs[i]->maxNumRegs;j++)
+      regs[i]->reg[j].nSent=0;
+    interrupts();
+    regs[i]->nLoads=0;
+    regs[i]->nLoadWaits=0;
+    regs[i]->loadWaitTime=0;
+  }
+} // Counters::reset
+
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned long Counters::nLoops=0;
+unsigned long Counters::maxLoop=0;
+unsigned long Counters::nCommands=0;
+unsigned int Counters::nParseErrors=0;
+unsigned int Counters::nTxStalls=0;
@@ -0,0 +1,27 @@
+/**********************************************************************
+
+Counters.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Counters_h
+#define Counters_h
+
+#include "Arduino.h"
+
+struct Counters{
+  static unsigned long nLoops;
+  static unsigned long maxLoop;
+  static unsigned long nCommands;
+  static unsigned int nParseErrors;
+  static unsigned int nTxStalls;
+  static void loop(unsigned long);
+  static void parse(char *c);
+  static void show();
+  static void reset();
+}; // Counters
+
+#endif
@@ -9,30 +9,174 @@ Part of DCC++ BASE STATION for the Arduino
 
 #include "DCCpp_Uno.h"
 #include "CurrentMonitor.h"
+#include "Clock.h"
+#include "Events.h"
+#include "Messages.h"
 #include "Comm.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
-CurrentMonitor::CurrentMonitor(int pin, char *msg){
+// EACH CURRENT MONITOR CONTROLS A SINGLE MOTOR SHIELD CHANNEL THROUGH ITS OWN ENABLE PIN, SO THAT AN OVERLOAD ON ONE CHANNEL
+// (E.G. A SHORT ON THE PROGRAMMING TRACK) DOES NOT INTERRUPT THE OTHER.  LIMIT IS SPECIFIED IN MILLIAMPS AND CONVERTED TO
+// analogRead() UNITS USING THE CURRENT SENSE RATIO OF THE SELECTED MOTOR SHIELD.  A LIMIT ABOVE THE LARGEST CURRENT THE SHIELD CAN
+// REPORT (5000 MILLIVOLTS AT THE SENSE PIN, E.G. ABOUT 3000 mA FOR THE ARDUINO MOTOR SHIELD) IS REDUCED TO CURRENT_LIMIT_MAX_READING.  ADDITIONAL MAIN TRACK DISTRICTS (SEE Config.h) ARE
+// CREATED WITH THE SHORTER FORM OF THE CONSTRUCTOR AND GIVEN THEIR DISTRICT NUMBER DURING SET-UP.
+
+CurrentMonitor::CurrentMonitor(int pin, int enablePin, int limit, const char *msg, const char *restoreMsg){
     this->pin=pin;
+    this->enablePin=enablePin;
+    long mv=constrain((long)limit*CURRENT_SENSE_MV_PER_AMP/1000,0L,5000L);      // milliamps -> millivolts (at sense pin), within the 0-5V range of analogRead()
+    this->limit=min(mv*1024/5000,(long)CURRENT_LIMIT_MAX_READING);             // millivolts -> analogRead() units (5V = 1024), kept below full scale so a saturated sense pin still trips
     this->msg=msg;
+    this->restoreMsg=restoreMsg;
     current=0;
+    state=CURRENT_OFF;
+    nTrips=0;
+    totalTrips=0;
+    overloaded=false;
+    stateTime=0;
+    ringIndex=0;
+    ringCount=0;
+    nDecimate=0;
+    windowMax=0;
+    peak=0;
+    ringSum=0;
+    district=0;
+  } // CurrentMonitor::CurrentMonitor
+
+CurrentMonitor::CurrentMonitor(int pin, int enablePin, int limit) : CurrentMonitor(pin,enablePin,limit,MSG_MAIN_OVERLOAD,MSG_MAIN_RESTORED){
   } // CurrentMonitor::CurrentMonitor
-  
-boolean CurrentMonitor::checkTime(){
-  if(millis()-sampleTime<CURRENT_SAMPLE_TIME)            // no need to check current yet
-    return(false);
-  sampleTime=millis();                                   // note millis() uses TIMER-0.  For UNO, we change the scale on Timer-0.  For MEGA we do not.  This means CURENT_SAMPLE_TIME is different for UNO then MEGA
-  return(true);  
-} // CurrentMonitor::checkTime
   
 void CurrentMonitor::check(){
-  current=analogRead(pin)*CURRENT_SAMPLE_SMOOTHING+current*(1.0-CURRENT_SAMPLE_SMOOTHING);        // compute new exponentially-smoothed current
-  if(current>CURRENT_SAMPLE_MAX && digitalRead(SIGNAL_ENABLE_PIN_PROG)==HIGH){                    // current overload and Prog Signal is on (or could have checked Main Signal, since both are always on or off together)
-    digitalWrite(SIGNAL_ENABLE_PIN_PROG,LOW);                                                     // disable both Motor Shield Channels
-    digitalWrite(SIGNAL_ENABLE_PIN_MAIN,LOW);                                                     // regardless of which caused current overload
-    INTERFACE.print(msg);                                                                         // print corresponding error message
-  }    
+  int reading=analogRead(pin);
+
+  current=reading*CURRENT_SAMPLE_SMOOTHING+current*(1.0-CURRENT_SAMPLE_SMOOTHING);                // compute new exponentially-smoothed current
+  record(reading);
+
+  if(state==CURRENT_ON){
+    if(current>limit){                                                                            // current overload
+      digitalWrite(enablePin,LOW);                                                                // disable only this Motor Shield Channel
+      nTrips++;
+      totalTrips++;
+      overloaded=true;
+      state=(nTrips>=CURRENT_RETRY_LIMIT)?CURRENT_OFF:CURRENT_TRIPPED;                            // give up re-trying after too many consecutive overloads
+      stateTime=Clock::ms();
+      report(false);                                                                              // print corresponding error message
+    } else if(nTrips>0 && Clock::ms()-stateTime>CURRENT_RETRY_CLEAR){                                // channel has been on long enough that prior overload is considered cleared
+      nTrips=0;
+    }
+  } else if(state==CURRENT_TRIPPED){
+    if(Clock::ms()-stateTime>=((unsigned long)CURRENT_RETRY_TIME<<min(nTrips-1,CURRENT_RETRY_MAX_SHIFT))){   // exponential back-off before re-trying
+      current=0;
+      digitalWrite(enablePin,HIGH);
+      state=CURRENT_ON;
+      stateTime=Clock::ms();
+      report(true);
+    }
+  }
 } // CurrentMonitor::check  
 
-long int CurrentMonitor::sampleTime=0;
+// TURNS CHANNEL ON OR OFF AT THE REQUEST OF THE USER, CLEARING ANY PRIOR OVERLOADS
+
+void CurrentMonitor::power(int on){
+  digitalWrite(enablePin,on?HIGH:LOW);
+  state=on?CURRENT_ON:CURRENT_OFF;
+  stateTime=Clock::ms();
+  nTrips=0;
+  overloaded=false;
+  current=0;
+} // CurrentMonitor::power
+
+// PRINTS THE OVERLOAD MESSAGE (OR, IF RESTORED, THE RESTORED MESSAGE) OF THE CHANNEL --- ADDITIONAL MAIN TRACK DISTRICTS
+// APPEND THEIR DISTRICT NUMBER, AS IN <p2 DISTRICT> OR <p1 MAIN DISTRICT>
+
+void CurrentMonitor::print(boolean restored){
+  if(district==0)
+    INTERFACE.print(MSG(restored?restoreMsg:msg));
+  else
+    Messages::print(INTERFACE,restored?PSTR("<p1 MAIN %d>"):PSTR("<p2 %d>"),district);
+} // CurrentMonitor::print
+
+// PRINTS THE MESSAGE AND RETURNS THE SAME MESSAGE AS A POWER EVENT (SEE Events.cpp)
+
+void CurrentMonitor::report(boolean restored){
+  print(restored);
+  if(district==0){
+    Events::message(EVENT_POWER,restored?restoreMsg:msg);
+  } else if(Events::begin(EVENT_POWER)){
+    Messages::print(INTERFACE,restored?PSTR("p1 MAIN %d"):PSTR("p2 %d"),district);
+    Events::end();
+  }
+} // CurrentMonitor::report
+
+// EVERY CURRENT_RING_DECIMATE RAW SAMPLES ARE REDUCED TO THEIR LARGEST VALUE (SO THAT BRIEF SPIKES ARE NOT AVERAGED AWAY) AND STORED,
+// DIVIDED BY 4 TO FIT IN A SINGLE BYTE, IN A RING HOLDING THE MOST RECENT CURRENT_RING_SIZE ENTRIES.  THE LARGEST RAW SAMPLE IS
+// SEPARATELY HELD UNTIL THE RING IS NEXT DUMPED.
+
+void CurrentMonitor::record(int reading){
+  if(reading>windowMax)
+    windowMax=reading;
+  if(reading>peak)
+    peak=reading;
+
+  if(++nDecimate<CURRENT_RING_DECIMATE)
+    return;
+
+  if(ringCount==CURRENT_RING_SIZE)                  // ring is full --- oldest entry drops out of running sum
+    ringSum-=ring[ringIndex];
+  else
+    ringCount++;
+
+  ring[ringIndex]=windowMax>>2;
+  ringSum+=ring[ringIndex];
+  ringIndex=(ringIndex+1)%CURRENT_RING_SIZE;
+
+  nDecimate=0;
+  windowMax=0;
+} // CurrentMonitor::record
+
+// PRINTS CONTENTS OF RING, OLDEST ENTRY FIRST, AS A SINGLE REPLY:
+// <a TRACK CURRENT MIN MAX MEAN PEAK TRIPS|HEX>
+// WHERE CURRENT, MIN, MAX, MEAN AND PEAK ARE IN analogRead() UNITS (0-1024) AND HEX IS TWO HEX DIGITS PER RING ENTRY (ENTRY = READING/4).
+// PEAK IS RESET ONCE REPORTED.
+
+void CurrentMonitor::dump(int track){
+  byte i,j,lo=255,hi=0;
+
+  for(i=0;i<ringCount;i++){
+    if(ring[i]<lo)
+      lo=ring[i];
+    if(ring[i]>hi)
+      hi=ring[i];
+  }
+  if(ringCount==0)
+    lo=0;
+
+  INTERFACE.print(F("<a"));
+  INTERFACE.print(track);
+  INTERFACE.print(' ');
+  INTERFACE.print(int(current));
+  INTERFACE.print(' ');
+  INTERFACE.print(lo*4);
+  INTERFACE.print(' ');
+  INTERFACE.print(hi*4);
+  INTERFACE.print(' ');
+  INTERFACE.print(ringCount==0?0:(int)(ringSum*4L/ringCount));
+  INTERFACE.print(' ');
+  INTERFACE.print(peak);
+  INTERFACE.print(' ');
+  INTERFACE.print(totalTrips);
+  INTERFACE.print('|');
+
+  j=(ringCount==CURRENT_RING_SIZE)?ringIndex:0;           // start with oldest entry
+  for(i=0;i<ringCount;i++){
+    if(ring[j]<16)
+      INTERFACE.print('0');
+    INTERFACE.print(ring[j],HEX);
+    j=(j+1)%CURRENT_RING_SIZE;
+  }
+  INTERFACE.print('>');
+
+  peak=0;
+} // CurrentMonitor::dump
+
@@ -11,25 +11,57 @@ Part of DCC++ BASE STATION for the Arduino
 #define CurrentMonitor_h
 
 #include "Arduino.h"
+#include "Config.h"
 
 #define  CURRENT_SAMPLE_SMOOTHING   0.01
-#define  CURRENT_SAMPLE_MAX         300
+#define  CURRENT_RING_DECIMATE      10          // number of current samples combined (keeping the largest) into each entry of the current history ring
+#define  CURRENT_RETRY_LIMIT        8           // number of consecutive overloads after which a channel is left off until re-enabled with the <1> command
+#define  CURRENT_RETRY_MAX_SHIFT    5           // the delay before re-trying an overloaded channel doubles with each consecutive overload, up to 2^CURRENT_RETRY_MAX_SHIFT times CURRENT_RETRY_TIME
+#define  CURRENT_LIMIT_MAX_READING  1000        // largest limit, in analogRead() units, that a channel is given --- a sense pin saturated at 1023 must still exceed it
+
+#define  CURRENT_SAMPLE_TIME        1000        // microseconds between current samples (see Clock.h and Scheduler.h)
+#define  CURRENT_SAMPLE_BUDGET      (150*(MAIN_DISTRICTS+2))   // microseconds expected to check both tracks and any additional main track districts (see Config.h)
+#define  CURRENT_RETRY_TIME         500         // milliseconds before first re-try of an overloaded channel
+#define  CURRENT_RETRY_CLEAR        10000       // consecutive overload count is cleared after channel has been on for this many milliseconds without overload
 
 #ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
-  #define  CURRENT_SAMPLE_TIME        10
+  #define  CURRENT_RING_SIZE          32        // number of entries in the current history ring of each track (kept small to conserve SRAM)
 #else                                         // Configuration for MEGA    
-  #define  CURRENT_SAMPLE_TIME        1
+  #define  CURRENT_RING_SIZE          64        // number of entries in the current history ring of each track
 #endif
 
+#define  CURRENT_OFF                0           // channel is off (either at start-up, by <0> command, or after too many consecutive overloads)
+#define  CURRENT_ON                 1           // channel is on
+#define  CURRENT_TRIPPED            2           // channel has been turned off due to an overload and will be re-tried
+
 struct CurrentMonitor{
-  static long int sampleTime;
   int pin;
+  int enablePin;
+  int limit;
   float current;
-  char *msg;
-  CurrentMonitor(int, char *);
-  static boolean checkTime();
+  const char *msg;                      // stored in flash (see Messages.h)
+  const char *restoreMsg;
+  byte state;
+  byte nTrips;
+  unsigned int totalTrips;
+  boolean overloaded;                   // channel was shut off by an overload (rather than by the user), and has not since been turned on or off with <1> or <0>
+  unsigned long stateTime;
+  byte ring[CURRENT_RING_SIZE];
+  byte ringIndex;
+  byte ringCount;
+  byte nDecimate;
+  int windowMax;
+  int peak;
+  unsigned int ringSum;
+  byte district;                        // 0 for the motor shield channels, otherwise the number of an additional main track district
+  CurrentMonitor(int, int, int, const char *, const char *);
+  CurrentMonitor(int, int, int);
   void check();
+  void power(int);
+  void print(boolean);
+  void report(boolean);
+  void record(int);
+  void dump(int);
 };
 
 #endif
-
@@ -39,6 +39,12 @@ Part of DCC++ BASE STATION for the Arduino
 
   #endif
 
+  #if SERIAL_PORTS != 0                   // Uno has no additional hardware serial ports
+
+    #error CANNOT COMPILE - DCC++ FOR THE UNO CANNOT USE ADDITIONAL SERIAL PORTS - PLEASE SET SERIAL_PORTS TO 0 IN THE CONFIG FILE
+
+  #endif
+
 #elif defined  ARDUINO_AVR_MEGA2560
 
   #define ARDUINO_TYPE    "MEGA"
@@ -65,6 +71,8 @@ Part of DCC++ BASE STATION for the Arduino
 
   #define CURRENT_MONITOR_PIN_MAIN A0
   #define CURRENT_MONITOR_PIN_PROG A1
+  #define CURRENT_SENSE_MV_PER_AMP 1650   // current sense output, in millivolts per amp
+  #define CURRENT_LIMIT_DEFAULT 888       // milliamps read as 300 by analogRead(), the limit of earlier versions
 
   #define DIRECTION_MOTOR_CHANNEL_PIN_A 12
   #define DIRECTION_MOTOR_CHANNEL_PIN_B 13
@@ -80,6 +88,8 @@ Part of DCC++ BASE STATION for the Arduino
 
   #define CURRENT_MONITOR_PIN_MAIN A0
   #define CURRENT_MONITOR_PIN_PROG A1
+  #define CURRENT_SENSE_MV_PER_AMP 525   // current sense output, in millivolts per amp
+  #define CURRENT_LIMIT_DEFAULT 2791     // milliamps read as 300 by analogRead(), the limit of earlier versions
 
   #define DIRECTION_MOTOR_CHANNEL_PIN_A 7
   #define DIRECTION_MOTOR_CHANNEL_PIN_B 8
@@ -95,6 +105,8 @@ Part of DCC++ BASE STATION for the Arduino
 
   #define CURRENT_MONITOR_PIN_MAIN A0
   #define CURRENT_MONITOR_PIN_PROG A1
+  #define CURRENT_SENSE_MV_PER_AMP 1650   // current sense output, in millivolts per amp
+  #define CURRENT_LIMIT_DEFAULT 888       // milliamps read as 300 by analogRead(), the limit of earlier versions
 
   #define DIRECTION_MOTOR_CHANNEL_PIN_A 7
   #define DIRECTION_MOTOR_CHANNEL_PIN_B 12
@@ -107,6 +119,14 @@ Part of DCC++ BASE STATION for the Arduino
 
 #endif
 
+#ifndef CURRENT_LIMIT_MAIN
+  #define CURRENT_LIMIT_MAIN CURRENT_LIMIT_DEFAULT
+#endif
+
+#ifndef CURRENT_LIMIT_PROG
+  #define CURRENT_LIMIT_PROG CURRENT_LIMIT_DEFAULT
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////////
 // SELECT COMMUNICATION INTERACE
 /////////////////////////////////////////////////////////////////////////////////////
@@ -114,12 +134,13 @@ Part of DCC++ BASE STATION for the Arduino
 #if COMM_INTERFACE == 0
 
   #define COMM_TYPE 0
-  #define INTERFACE Serial
+  #define COMM_PORT Serial
 
 #elif (COMM_INTERFACE==1) || (COMM_INTERFACE==2) || (COMM_INTERFACE==3)
 
   #define COMM_TYPE 1
-  #define INTERFACE eServer
+  #define COMM_PORT eServer
+  #define COMM_UDP eUdp
   #define SDCARD_CS 4
   
 #else
@@ -128,15 +149,18 @@ Part of DCC++ BASE STATION for the Arduino
 
 #endif
 
+#define INTERFACE Session::reply            // all replies are routed to the session that sent the command, or to every session (see Session.cpp)
+
 /////////////////////////////////////////////////////////////////////////////////////
 // SET WHETHER TO SHOW PACKETS - DIAGNOSTIC MODE ONLY
 /////////////////////////////////////////////////////////////////////////////////////
 
-// If SHOW_PACKETS is set to 1, then for select main operations track commands that modify an internal DCC packet register,
-// if printFlag for that command is also set to 1, DCC++ BASE STATION will additionally return the 
-// DCC packet contents of the modified register in the following format:
+// For select main operations track commands that modify an internal DCC packet register (i.e. if printFlag for that
+// command is set to 1), DCC++ BASE STATION always records the DCC packet contents of the modified register in a trace
+// that can be read with the <*> command (see PacketTrace.cpp).  If SHOW_PACKETS is set to 1, DCC++ BASE STATION will
+// additionally return each packet from a low-priority scheduled task in the following format:
 
-//    <* REG: B1 B2 ... Bn CSUM / REPEAT>
+//    <* REG: B1 B2 ... Bn CSUM / REPEAT @ TIME>
 //
 //    REG: the number of the main operations track packet register that was modified
 //    B1: the first hexidecimal byte of the DCC packet
@@ -144,6 +168,7 @@ Part of DCC++ BASE STATION for the Arduino
 //    Bn: the nth hexidecimal byte of the DCC packet
 //    CSUM: a checksum byte that is required to be the final byte in any DCC packet
 //    REPEAT: the number of times the DCC packet was re-transmitted to the tracks after its iniital transmission
+//    TIME: the time the packet was loaded, in microseconds since start-up
  
 #define SHOW_PACKETS  0       // set to zero to disable printing of every packet for select main operations track commands
 
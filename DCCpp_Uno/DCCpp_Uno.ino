@@ -35,6 +35,7 @@ This version of DCC++ BASE STATION supports:
   * Cab functions F0-F28
   * Activate/de-activate accessory functions using 512 addresses, each with 4 sub-addresses
       - includes optional functionailty to monitor and store of the direction of any connected turnouts
+      - includes optional routes that set any number of stored turnouts and outputs with a single command
   * Programming on the Main Operations Track
       - write configuration variable bytes
       - set/clear specific configuration variable bits
@@ -42,6 +43,7 @@ This version of DCC++ BASE STATION supports:
       - write configuration variable bytes
       - set/clear specific configuration variable bits
       - read configuration variable bytes
+      - batch-read and cache configuration variables of identified decoders
 
 DCC++ BASE STATION is controlled with simple text commands received via
 the Arduino's serial interface.  Users can type these commands directly
@@ -147,9 +149,16 @@ DCC++ BASE STATION in split into multiple modules, each with its own header file
 
   PacketRegister:   contains methods to load, store, and update Packet Registers with DCC instructions
 
+  AckDetector:      contains methods to decide whether a decoder on the Programming Track has acknowledged a CV verify,
+                    learning the baseline current and noise and ending each sampling window as soon as the answer is clear
+
+  Roster:           contains methods to cache Configuration Variables read from decoders on the Programming Track,
+                    keyed by decoder manufacturer, version, and address
+
   CurrentMonitor:   contains methods to separately monitor and report the current drawn from CHANNEL A and
-                    CHANNEL B of the Arduino Motor Shield's, and shut down power if a short-circuit overload
-                    is detected
+                    CHANNEL B of the Arduino Motor Shield's, and shut down power to just that channel if a short-circuit overload
+                    is detected, automatically re-trying with increasing delays --- optionally also monitors additional
+                    Main Track power districts, each driven by its own booster from the same Main Track signal
 
   Accessories:      contains methods to operate and store the status of any optionally-defined turnouts controlled
                     by a DCC stationary accessory decoder.
@@ -159,9 +168,49 @@ DCC++ BASE STATION in split into multiple modules, each with its own header file
 
   Outputs:          contains methods to configure one or more Arduino pins as an output for your own custom use
 
+  Routes:           contains methods to group turnouts and outputs into routes that can be set with a single command,
+                    pacing turnout activations so as not to overload solenoid power supplies
+
+  Reflex:           contains methods to stop a train as soon as it triggers a sensor, and to measure how long
+                    the resulting throttle packet takes to reach the track
+
+  Automation:       contains methods to carry out actions defined for sensors, turnouts, and timers as soon as they are
+                    triggered, without waiting for an interface to react
+
   EEStore:          contains methods to store, update, and load various DCC settings and status
                     (e.g. the states of all defined turnouts) in the EEPROM for recall after power-up
 
+  Clock:            contains methods to provide a microsecond and millisecond timebase, driven by Timer 2,
+                    that has the same meaning on both the Uno and Mega
+
+  Scheduler:        contains methods to run each of the above subsystems as a task with its own period and time budget,
+                    keeping current monitoring running during long operations, and report scheduling statistics
+
+  Counters:         contains methods to report and reset performance counters kept by the DCC signal interrupts,
+                    Packet Registers, command parser, and main loop
+
+  Histogram:        contains methods to record and report the distribution of main loop, task, and packet loading times
+
+  ParseCost:        contains methods to time every command and retain the most expensive, as a worst-case parse-time budget
+
+  Recorder:         contains methods to record commands and sensor transitions into a time-stamped log, and to
+                    replay that log with its original timing or as fast as possible
+
+  PacketTrace:      contains methods to record and report a trace of recent DCC packets loaded into the main operations track registers
+
+  BinaryCommand:    contains methods to read and execute compact binary versions of the most frequently-used text commands,
+                    and return binary replies
+
+  Events:           contains methods to return only those changes in state an interface has subscribed to, and a digest of
+                    the current state, so that the interface need not repeatedly poll with the <s> command
+
+  Session:          contains methods to separately receive commands from, and route replies to, each connected interface
+                    (e.g. each Ethernet client or additional Mega serial port), taking turns between them, and broadcasting
+                    returns not prompted by a command to every interface
+
+  Messages:         contains a catalog of replies stored in flash rather than SRAM, and methods to print formatted
+                    replies directly from flash
+
 DCC++ BASE STATION is configured through the Config.h file that contains all user-definable parameters                    
 
 **********************************************************************/
@@ -174,7 +223,20 @@ DCC++ BASE STATION is configured through the Config.h file that contains all use
 #include "Sensor.h"
 #include "SerialCommand.h"
 #include "Accessories.h"
+#include "Routes.h"
+#include "Automation.h"
+#include "Reflex.h"
 #include "EEStore.h"
+#include "Clock.h"
+#include "Scheduler.h"
+#include "Counters.h"
+#include "Histogram.h"
+#include "PacketTrace.h"
+#include "Recorder.h"
+#include "ParseCost.h"
+#include "Events.h"
+#include "Session.h"
+#include "Messages.h"
 #include "Config.h"
 #include "Comm.h"
 
@@ -184,7 +246,10 @@ void showConfiguration();
 
 #if COMM_TYPE == 1
   byte mac[] =  MAC_ADDRESS;                                // Create MAC address (to be used for DHCP when initializing server)
-  EthernetServer INTERFACE(ETHERNET_PORT);                  // Create and instance of an EnternetServer
+  EthernetServer COMM_PORT(ETHERNET_PORT);                  // Create and instance of an EnternetServer
+  #ifdef UDP_PORT
+    EthernetUDP COMM_UDP;                                   // Create an instance of EthernetUDP to receive command datagrams
+  #endif
 #endif
 
 // NEXT DECLARE GLOBAL OBJECTS TO PROCESS AND STORE DCC PACKETS AND MONITOR TRACK CURRENTS.
@@ -193,26 +258,47 @@ void showConfiguration();
 volatile RegisterList mainRegs(MAX_MAIN_REGISTERS);    // create list of registers for MAX_MAIN_REGISTER Main Track Packets
 volatile RegisterList progRegs(2);                     // create a shorter list of only two registers for Program Track Packets
 
-CurrentMonitor mainMonitor(CURRENT_MONITOR_PIN_MAIN,"<p2>");  // create monitor for current on Main Track
-CurrentMonitor progMonitor(CURRENT_MONITOR_PIN_PROG,"<p3>");  // create monitor for current on Program Track
+#if MAIN_DISTRICTS>0
+  #define MAIN_DISTRICT_MONITORS , MAIN_DISTRICT_LIST
+#else
+  #define MAIN_DISTRICT_MONITORS
+#endif
+
+CurrentMonitor mainMonitor[MAIN_DISTRICTS+1]={                   // create monitors for current on Main Track and any additional Main Track districts
+  CurrentMonitor(CURRENT_MONITOR_PIN_MAIN,SIGNAL_ENABLE_PIN_MAIN,CURRENT_LIMIT_MAIN,MSG_MAIN_OVERLOAD,MSG_MAIN_RESTORED) MAIN_DISTRICT_MONITORS
+};
+CurrentMonitor progMonitor(CURRENT_MONITOR_PIN_PROG,SIGNAL_ENABLE_PIN_PROG,CURRENT_LIMIT_PROG,MSG_PROG_OVERLOAD,MSG_PROG_RESTORED);  // create monitor for current on Program Track
 
 ///////////////////////////////////////////////////////////////////////////////
 // MAIN ARDUINO LOOP
 ///////////////////////////////////////////////////////////////////////////////
 
 void loop(){
+  unsigned long t=Clock::us();
   
-  SerialCommand::process();              // check for, and process, any new serial commands
-  
-  if(CurrentMonitor::checkTime()){      // if sufficient time has elapsed since last update, check current draw on Main and Program Tracks 
-    mainMonitor.check();
-    progMonitor.check();
-  }
+  Scheduler::run();                     // run each task that is due, most overdue first
+  Session::flushAll();                  // write out any replies or broadcasts still buffered
 
-  Sensor::check();    // check sensors for activate/de-activate
+  t=Clock::us()-t;
+  Counters::loop(t);                    // count loop iterations and time the longest
+  Histogram::loopTime.add(t);           // record distribution of loop iteration times
   
 } // loop
 
+///////////////////////////////////////////////////////////////////////////////
+
+void checkCurrent(){                    // check current draw on Main and Program Tracks
+  mainMonitor[0].check();
+  progMonitor.check();
+  Events::current(0,mainMonitor[0].current);   // return event if current has crossed subscribed threshold
+  Events::current(1,progMonitor.current);
+
+  for(int i=1;i<=MAIN_DISTRICTS;i++){   // check each additional Main Track district independently of the others
+    mainMonitor[i].check();
+    Events::current(i+1,mainMonitor[i].current);
+  }
+} // checkCurrent
+
 ///////////////////////////////////////////////////////////////////////////////
 // INITIAL SETUP
 ///////////////////////////////////////////////////////////////////////////////
@@ -222,29 +308,21 @@ void setup(){
   Serial.begin(115200);            // configure serial interface
   Serial.flush();
 
+  Clock::begin();                  // start Timer 2 timebase before anything that needs to measure time
+
   #ifdef SDCARD_CS
     pinMode(SDCARD_CS,OUTPUT);
     digitalWrite(SDCARD_CS,HIGH);     // Deselect the SD card
   #endif
 
-  EEStore::init();                                          // initialize and load Accessory (Turnout), Output, and Sensor definitions stored in EEPROM
+  EEStore::init();                                          // initialize and load Accessory (Turnout), Output, Sensor, and Route definitions stored in EEPROM
 
   pinMode(SHOW_CONFIG_PIN,INPUT);                                       // if pin A5 is grounded upon start-up, print system configuration and halt
   digitalWrite(SHOW_CONFIG_PIN,HIGH);
   if(!digitalRead(SHOW_CONFIG_PIN))
     showConfiguration();
 
-  Serial.print("<iDCC++ BASE STATION FOR ARDUINO ");      // Print Status to Serial Line regardless of COMM_TYPE setting so user can open Serial Monitor and check configurtion 
-  Serial.print(ARDUINO_TYPE);
-  Serial.print(" / ");
-  Serial.print(MOTOR_SHIELD_NAME);
-  Serial.print(": V-");
-  Serial.print(VERSION);
-  Serial.print(" / ");
-  Serial.print(__DATE__);
-  Serial.print(" ");
-  Serial.print(__TIME__);
-  Serial.print(">");
+  Serial.print(MSG(MSG_BANNER));            // Print Status to Serial Line regardless of COMM_TYPE setting so user can open Serial Monitor and check configurtion 
 
   #if COMM_TYPE == 1
     #ifdef IP_ADDRESS
@@ -252,20 +330,37 @@ void setup(){
     #else
       Ethernet.begin(mac);                      // Start networking using DHCP to get an IP Address
     #endif
-    INTERFACE.begin();
+    COMM_PORT.begin();
+    #ifdef UDP_PORT
+      COMM_UDP.begin(UDP_PORT);
+    #endif
   #endif
              
-  SerialCommand::init(&mainRegs, &progRegs, &mainMonitor);   // create structure to read and parse commands from serial line
+  SerialCommand::init(&mainRegs, &progRegs, mainMonitor, &progMonitor);     // create structure to read and parse commands from serial line
+  Session::begin();                                                         // open a session for each serial port that accepts commands
+
+  // REGISTER TASKS TO BE RUN BY THE SCHEDULER FROM WITHIN THE MAIN LOOP
+
+  Scheduler::add(PSTR("CURRENT"),checkCurrent,CURRENT_SAMPLE_TIME,CURRENT_SAMPLE_BUDGET,TASK_CRITICAL);   // critical --- also run while waiting on long operations
+  Scheduler::add(PSTR("SERIAL"),Session::process,0,SERIAL_COMMAND_BUDGET);            // check for, and process, any new commands from each session
+  Scheduler::add(PSTR("SENSOR"),Sensor::check,SENSOR_SAMPLE_TIME,SENSOR_SAMPLE_BUDGET);  // check sensors for activate/de-activate
+  Scheduler::add(PSTR("ROUTE"),Route::check,0,ROUTE_CHECK_BUDGET);                    // continue firing any routes in progress
+  Scheduler::add(PSTR("REFLEX"),Reflex::check,0,REFLEX_CHECK_BUDGET);                 // complete latency measurement of any stop reflex
+  Scheduler::add(PSTR("AUTO"),Automation::check,AUTOMATION_CHECK_TIME,AUTOMATION_CHECK_BUDGET);   // run automation handlers of any expired timers
+  Scheduler::add(PSTR("REPLAY"),Recorder::check,0,RECORDER_CHECK_BUDGET);             // replay next record of any log being replayed
+  #if SHOW_PACKETS
+    Scheduler::add(PSTR("TRACE"),PacketTrace::drain,0,PACKET_TRACE_BUDGET);          // print packets recorded in trace
+  #endif
 
-  Serial.print("<N");
+  Serial.print(F("<N"));
   Serial.print(COMM_TYPE);
-  Serial.print(": ");
+  Serial.print(F(": "));
 
   #if COMM_TYPE == 0
-    Serial.print("SERIAL>");
+    Serial.print(F("SERIAL>"));
   #elif COMM_TYPE == 1
     Serial.print(Ethernet.localIP());
-    Serial.print(">");
+    Serial.print('>');
   #endif
   
   // CONFIGURE TIMER_1 TO OUTPUT 50% DUTY CYCLE DCC SIGNALS ON OC1B INTERRUPT PINS
@@ -303,6 +398,11 @@ void setup(){
   
   pinMode(SIGNAL_ENABLE_PIN_MAIN,OUTPUT);   // master enable for motor channel A
 
+  for(int i=1;i<=MAIN_DISTRICTS;i++){       // enable for each additional Main Track district, whose booster takes its direction from DCC_SIGNAL_PIN_MAIN
+    mainMonitor[i].district=i;
+    pinMode(mainMonitor[i].enablePin,OUTPUT);
+  }
+
   mainRegs.loadPacket(1,RegisterList::idlePacket,2,0);    // load idle packet into register 1    
       
   bitSet(TIMSK1,OCIE1B);    // enable interrupt vector for Timer 1 Output Compare B Match (OCR1B)    
@@ -409,6 +509,11 @@ void setup(){
 // registers would not be updated, and the net effect would be a DCC signal that keeps sending the same DCC bit repeatedly until the
 // interrupt code completes and can be called again.
 
+// The same happens if this interrupt is delayed by other interrupts or by code that temporarily disables interrupts.  To detect this,
+// the interrupt code first checks whether Timer-N has already counted past the end of the current bit (i.e. it has wrapped around
+// and is now below OCNB) before the new OCNA and OCNB values have been set.  Each such OVERRUN is counted, and the register and bit
+// that were affected by the most recent overrun are saved, for reporting with the <G> command (see Counters.cpp).
+
 // A significant portion of this entire program is designed to do as much of the heavy processing of creating a properly-formed
 // DCC bit stream upfront, so that the interrupt code below can be as simple and efficient as possible.
 
@@ -418,18 +523,28 @@ void setup(){
 // some of the logic for each interrupt, but saves additional time.
 
 // As structured, the interrupt code below completes at an average of just under 6 microseconds with a worse-case of just under 11 microseconds
-// when a new register is loaded and the logic needs to switch active register packet pointers.
+// when a new register is loaded and the logic needs to switch active register packet pointers (plus a few microseconds to time-stamp the switch).
 
 // THE INTERRUPT CODE MACRO:  R=REGISTER LIST (mainRegs or progRegs), and N=TIMER (0 or 1)
 
 #define DCC_SIGNAL(R,N) \
+  R.nInterrupts++;                                        /* count each interrupt (see Counters.cpp) */ \
+  if(TCNT ## N < OCR ## N ## B){                          /* IF timer has already wrapped around, this interrupt was too late to set next bit in time */ \
+    R.nOverruns++;                                        /*   count overrun and save register and bit that were affected */ \
+    R.overrunReg=R.currentReg-R.reg;                      \
+    R.overrunBit=R.currentBit;                            \
+  }                                                       \
   if(R.currentBit==R.currentReg->activePacket->nBits){    /* IF no more bits in this DCC Packet */ \
+    R.nPackets++;                                         /*   count the packet just completed, both in total and for its Register */ \
+    R.currentReg->nSent++;                                \
     R.currentBit=0;                                       /*   reset current bit pointer and determine which Register and Packet to process next--- */ \
     if(R.nRepeat>0 && R.currentReg==R.reg){               /*   IF current Register is first Register AND should be repeated */ \
       R.nRepeat--;                                        /*     decrement repeat count; result is this same Packet will be repeated */ \
     } else if(R.nextReg!=NULL){                           /*   ELSE IF another Register has been updated */ \
       R.currentReg=R.nextReg;                             /*     update currentReg to nextReg */ \
       R.nextReg=NULL;                                     /*     reset nextReg to NULL */ \
+      R.pickupReg=R.currentReg;                           /*     time-stamp the pick-up (see Reflex.cpp) */ \
+      R.pickupTime=Clock::us();                           \
       R.tempPacket=R.currentReg->activePacket;            /*     flip active and update Packets */ \
       R.currentReg->activePacket=R.currentReg->updatePacket; \
       R.currentReg->updatePacket=R.tempPacket; \
@@ -481,60 +596,75 @@ void showConfiguration(){
 
   int mac_address[]=MAC_ADDRESS;
 
-  Serial.print("\n*** DCC++ CONFIGURATION ***\n");
+  Serial.print(F("\n*** DCC++ CONFIGURATION ***\n"));
 
-  Serial.print("\nVERSION:      ");
-  Serial.print(VERSION);
-  Serial.print("\nCOMPILED:     ");
-  Serial.print(__DATE__);
-  Serial.print(" ");
-  Serial.print(__TIME__);
+  Serial.print(F("\nVERSION:      "));
+  Serial.print(F(VERSION));
+  Serial.print(F("\nCOMPILED:     "));
+  Serial.print(F(__DATE__));
+  Serial.print(' ');
+  Serial.print(F(__TIME__));
 
-  Serial.print("\nARDUINO:      ");
-  Serial.print(ARDUINO_TYPE);
+  Serial.print(F("\nARDUINO:      "));
+  Serial.print(F(ARDUINO_TYPE));
 
-  Serial.print("\n\nMOTOR SHIELD: ");
-  Serial.print(MOTOR_SHIELD_NAME);
+  Serial.print(F("\n\nMOTOR SHIELD: "));
+  Serial.print(F(MOTOR_SHIELD_NAME));
   
-  Serial.print("\n\nDCC SIG MAIN: ");
+  Serial.print(F("\n\nDCC SIG MAIN: "));
   Serial.print(DCC_SIGNAL_PIN_MAIN);
-  Serial.print("\n   DIRECTION: ");
+  Serial.print(F("\n   DIRECTION: "));
   Serial.print(DIRECTION_MOTOR_CHANNEL_PIN_A);
-  Serial.print("\n      ENABLE: ");
+  Serial.print(F("\n      ENABLE: "));
   Serial.print(SIGNAL_ENABLE_PIN_MAIN);
-  Serial.print("\n     CURRENT: ");
+  Serial.print(F("\n     CURRENT: "));
   Serial.print(CURRENT_MONITOR_PIN_MAIN);
 
-  Serial.print("\n\nDCC SIG PROG: ");
+  for(int i=1;i<=MAIN_DISTRICTS;i++){
+    Serial.print(F("\n    DISTRICT: "));
+    Serial.print(i);
+    Serial.print(F("\n      ENABLE: "));
+    Serial.print(mainMonitor[i].enablePin);
+    Serial.print(F("\n     CURRENT: "));
+    Serial.print(mainMonitor[i].pin);
+  }
+
+  Serial.print(F("\n\nDCC SIG PROG: "));
   Serial.print(DCC_SIGNAL_PIN_PROG);
-  Serial.print("\n   DIRECTION: ");
+  Serial.print(F("\n   DIRECTION: "));
   Serial.print(DIRECTION_MOTOR_CHANNEL_PIN_B);
-  Serial.print("\n      ENABLE: ");
+  Serial.print(F("\n      ENABLE: "));
   Serial.print(SIGNAL_ENABLE_PIN_PROG);
-  Serial.print("\n     CURRENT: ");
+  Serial.print(F("\n     CURRENT: "));
   Serial.print(CURRENT_MONITOR_PIN_PROG);
 
-  Serial.print("\n\nNUM TURNOUTS: ");
+  Serial.print(F("\n\nNUM TURNOUTS: "));
   Serial.print(EEStore::eeStore->data.nTurnouts);
-  Serial.print("\n     SENSORS: ");
+  Serial.print(F("\n     SENSORS: "));
   Serial.print(EEStore::eeStore->data.nSensors);
-  Serial.print("\n     OUTPUTS: ");
+  Serial.print(F("\n     OUTPUTS: "));
   Serial.print(EEStore::eeStore->data.nOutputs);
+  Serial.print(F("\n      ROUTES: "));
+  Serial.print(EEStore::eeStore->data.nRoutes);
   
-  Serial.print("\n\nINTERFACE:    ");
+  Serial.print(F("\n\nINTERFACE:    "));
   #if COMM_TYPE == 0
-    Serial.print("SERIAL");
+    Serial.print(F("SERIAL"));
   #elif COMM_TYPE == 1
-    Serial.print(COMM_SHIELD_NAME);
-    Serial.print("\nMAC ADDRESS:  ");
+    Serial.print(F(COMM_SHIELD_NAME));
+    Serial.print(F("\nMAC ADDRESS:  "));
     for(int i=0;i<5;i++){
       Serial.print(mac_address[i],HEX);
-      Serial.print(":");
+      Serial.print(':');
     }
     Serial.print(mac_address[5],HEX);
-    Serial.print("\nPORT:         ");
+    Serial.print(F("\nPORT:         "));
     Serial.print(ETHERNET_PORT);
-    Serial.print("\nIP ADDRESS:   ");
+    #ifdef UDP_PORT
+      Serial.print(F("\nUDP PORT:     "));
+      Serial.print(UDP_PORT);
+    #endif
+    Serial.print(F("\nIP ADDRESS:   "));
 
     #ifdef IP_ADDRESS
       Ethernet.begin(mac,IP_ADDRESS);           // Start networking using STATIC IP Address
@@ -545,13 +675,23 @@ void showConfiguration(){
     Serial.print(Ethernet.localIP());
 
     #ifdef IP_ADDRESS
-      Serial.print(" (STATIC)");
+      Serial.print(F(" (STATIC)"));
     #else
-      Serial.print(" (DHCP)");
+      Serial.print(F(" (DHCP)"));
     #endif
   
   #endif
-  Serial.print("\n\nPROGRAM HALTED - PLEASE RESTART ARDUINO");
+
+  #if SERIAL_PORTS != 0
+    Serial.print(F("\nSERIAL PORTS: "));
+    for(int i=0;i<3;i++){
+      if(bitRead(SERIAL_PORTS,i)){
+        Serial.print(F(" Serial"));
+        Serial.print(i+1);
+      }
+    }
+  #endif
+  Serial.print(F("\n\nPROGRAM HALTED - PLEASE RESTART ARDUINO"));
 
   while(true);
 }
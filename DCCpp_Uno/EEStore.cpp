@@ -12,6 +12,9 @@ Part of DCC++ BASE STATION for the Arduino
 #include "Accessories.h"
 #include "Sensor.h"
 #include "Outputs.h"
+#include "Routes.h"
+#include "Reflex.h"
+#include "Automation.h"
 #include <EEPROM.h>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -23,11 +26,14 @@ void EEStore::init(){
 
   EEPROM.get(0,eeStore->data);                                       // get eeStore data 
   
-  if(strncmp(eeStore->data.id,EESTORE_ID,sizeof(EESTORE_ID))!=0){    // check to see that eeStore contains valid DCC++ ID
-    sprintf(eeStore->data.id,EESTORE_ID);                            // if not, create blank eeStore structure (no turnouts, no sensors, no outputs) and save it back to EEPROM
+  if(strncmp(eeStore->data.id,EESTORE_ID,sizeof(EESTORE_ID))!=0 && !migrate()){    // check to see that eeStore contains valid DCC++ ID, or one that can be migrated
+    sprintf(eeStore->data.id,EESTORE_ID);                            // if not, create blank eeStore structure (no turnouts, no sensors, no outputs, no routes) and save it back to EEPROM
     eeStore->data.nTurnouts=0;
     eeStore->data.nSensors=0;
     eeStore->data.nOutputs=0;
+    eeStore->data.nRoutes=0;
+    eeStore->data.nReflexes=0;
+    eeStore->data.nAutomation=0;
     EEPROM.put(0,eeStore->data);    
   }
   
@@ -35,17 +41,55 @@ void EEStore::init(){
   Turnout::load();    // load turnout definitions
   Sensor::load();     // load sensor definitions
   Output::load();     // load output definitions
+  Route::load();      // load route definitions
+  Reflex::load();     // load stop reflex definitions
+  Automation::load(); // load automation handlers
   
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// CONVERTS AN EEPROM WRITTEN WITH THE SHORTER EESTORE_ID_V1 HEADER BY MOVING ITS TURNOUT, SENSOR, AND OUTPUT DEFINITIONS UP TO
+// FOLLOW THE CURRENT HEADER (LAST BYTE FIRST, SINCE THE TWO RANGES OVERLAP), WITH NO ROUTES, STOP REFLEXES OR AUTOMATION.
+// RETURNS FALSE, LEAVING THE EEPROM UNCHANGED, IF THE EEPROM DOES NOT HOLD A VALID EESTORE_ID_V1 IMAGE
+
+boolean EEStore::migrate(){
+  EEStoreDataV1 v1;
+  long n;
+
+  EEPROM.get(0,v1);
+  if(strncmp(v1.id,EESTORE_ID_V1,sizeof(EESTORE_ID_V1))!=0 || v1.nTurnouts<0 || v1.nSensors<0 || v1.nOutputs<0)
+    return(false);
+
+  n=(long)v1.nTurnouts*sizeof(TurnoutData)+(long)v1.nSensors*sizeof(SensorData)+(long)v1.nOutputs*sizeof(OutputData);
+  if(sizeof(EEStore)+n>EEPROM.length())
+    return(false);
+
+  for(int i=n-1;i>=0;i--)
+    EEPROM.update(sizeof(EEStore)+i,EEPROM.read(sizeof(EEStoreDataV1)+i));
+
+  sprintf(eeStore->data.id,EESTORE_ID);
+  eeStore->data.nTurnouts=v1.nTurnouts;
+  eeStore->data.nSensors=v1.nSensors;
+  eeStore->data.nOutputs=v1.nOutputs;
+  eeStore->data.nRoutes=0;
+  eeStore->data.nReflexes=0;
+  eeStore->data.nAutomation=0;
+  EEPROM.put(0,eeStore->data);
+  return(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void EEStore::clear(){
     
-  sprintf(eeStore->data.id,EESTORE_ID);                              // create blank eeStore structure (no turnouts, no sensors, no outputs) and save it back to EEPROM
+  sprintf(eeStore->data.id,EESTORE_ID);                              // create blank eeStore structure (no turnouts, no sensors, no outputs, no routes) and save it back to EEPROM
   eeStore->data.nTurnouts=0;
   eeStore->data.nSensors=0;
   eeStore->data.nOutputs=0;
+  eeStore->data.nRoutes=0;
+  eeStore->data.nReflexes=0;
+  eeStore->data.nAutomation=0;
   EEPROM.put(0,eeStore->data);    
   
 }
@@ -57,6 +101,9 @@ void EEStore::store(){
   Turnout::store();
   Sensor::store();  
   Output::store();  
+  Route::store();
+  Reflex::store();
+  Automation::store();
   EEPROM.put(0,eeStore->data);    
 }
 
@@ -10,13 +10,26 @@ Part of DCC++ BASE STATION for the Arduino
 #ifndef EEStore_h
 #define EEStore_h
 
-#define  EESTORE_ID "DCC++"
+#include "Arduino.h"
+
+#define  EESTORE_ID      "DCC+2"       // changed whenever EEStoreData changes, so that an EEPROM written by older firmware is never misread
+#define  EESTORE_ID_V1   "DCC++"       // ID of EEPROM written before routes, stop reflexes and automation were stored --- migrated by init()
+
+struct EEStoreDataV1{
+  char id[sizeof(EESTORE_ID_V1)];
+  int nTurnouts;
+  int nSensors;
+  int nOutputs;
+};
 
 struct EEStoreData{
   char id[sizeof(EESTORE_ID)];
   int nTurnouts;
   int nSensors;  
   int nOutputs;
+  int nRoutes;
+  int nReflexes;
+  int nAutomation;                    // bytes of automation byte code (see Automation.cpp)
 };
 
 struct EEStore{
@@ -24,6 +37,7 @@ struct EEStore{
   EEStoreData data;
   static int eeAddress;
   static void init();
+  static boolean migrate();
   static void reset();
   static int pointer();
   static void advance(int);
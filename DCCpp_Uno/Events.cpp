@@ -0,0 +1,205 @@
+/**********************************************************************
+
+Events.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+Rather than repeatedly polling DCC++ BASE STATION with the <s> command to find out what has changed, an interface
+can SUBSCRIBE to one or more classes of EVENTS.  Each time the state of DCC++ BASE STATION changes in a subscribed class,
+regardless of which command (or sensor, or overload) caused the change, an event is returned of the form:
+
+  <@SEQ REPLY>
+
+where
+
+  SEQ: a sequence number that increases by one with each event returned, allowing an interface to detect a missed event
+       (each session --- e.g. each Ethernet client --- subscribes separately and has its own SEQ, see Session.cpp)
+  REPLY: the same contents as the reply that would be returned by the equivalent command (without its < > brackets), as follows:
+
+    SPEED (1):      TREGISTER SPEED DIRECTION      - a throttle was set (as for <t>)
+    TURNOUT (2):    HID THROW                      - a turnout was thrown or unthrown (as for <T>)
+    OUTPUT (4):     YID STATE                      - an output was set (as for <Z>)
+    SENSOR (8):     QID or qID                     - a sensor was triggered or is no longer triggered
+    POWER (16):     p0, p1, p2, p3, p1 MAIN, or p1 PROG  - track power was turned off or on, was shut off due to an overload, or was restored
+                    p2 DISTRICT or p1 MAIN DISTRICT      - an additional main operations track district (see Config.h) was shut off or restored
+    CURRENT (32):   aTRACK CURRENT                 - the smoothed current on TRACK (0=main operations track, 1=programming track,
+                                                     2 or more=additional main operations track district TRACK-1) rose above
+                                                     THRESHOLD, or fell back below it
+
+To subscribe use:
+
+  <@ MASK [THRESHOLD]>:        subscribes to the events classes in MASK (the sum of the numbers in parentheses above), replacing any
+                               prior subscription (MASK=0 to unsubscribe), and optionally sets THRESHOLD (0-1024) for CURRENT events
+                               (THRESHOLD is shared by all sessions)
+                               returns: <O>, or <X> if THRESHOLD is out of range
+
+To check whether anything has been missed without a full <s> resync use:
+
+  <@>:                         returns: <@SEQ DIGEST>
+
+where
+
+  SEQ: the sequence number of the last event returned --- if this matches the last event received, none were missed
+  DIGEST: a 16-bit checksum (0-65535) of track power, throttle, turnout, output, and sensor states --- if this matches the DIGEST returned
+          immediately after a prior resync, the state of DCC++ BASE STATION is the same as it was then, even if DCC++ BASE STATION
+          has since been restarted (which resets SEQ)
+
+Both forms return <X> if they are not sent by a session, e.g. if carried out from a handler or a replayed log (see Recorder.cpp).
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Events.h"
+#include "SerialCommand.h"
+#include "Accessories.h"
+#include "Outputs.h"
+#include "Sensor.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS TRUE, HAVING STARTED AN EVENT, IF EVENT CLASS E IS SUBSCRIBED --- THE CALLER THEN PRINTS THE REPLY AND CALLS END()
+
+boolean Events::begin(byte e){
+  boolean any=false;
+
+  for(Session *s=Session::session;s<Session::session+MAX_SESSIONS;s++){     // each session numbers its own events
+    if(s->active && (s->eventMask&e)){
+      s->print(F("<@"));
+      s->print(++s->eventSeq);
+      s->print(' ');
+      any=true;
+    }
+  }
+
+  if(any)
+    Session::eventClass=e;            // route remainder of event to subscribed sessions only (see Session.cpp)
+  return(any);
+} // Events::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Events::end(){
+  INTERFACE.print('>');
+  Session::eventClass=0;
+} // Events::end
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS AN EVENT WHOSE REPLY IS THE TEXT OF MESSAGE MSG (E.G. MSG_MAIN_OVERLOAD, "<p2>", STORED IN FLASH) WITHOUT ITS < > BRACKETS
+
+void Events::message(byte e, const char *msg){
+  char c;
+
+  if(!begin(e))
+    return;
+  for(msg++;(c=pgm_read_byte(msg))!='\0' && c!='>';msg++)
+    INTERFACE.print(c);
+  end();
+} // Events::message
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Events::current(int track, float c){
+  if(!Session::subscribed(EVENT_CURRENT))
+    return;
+
+  if(currentAbove[track]?(c>=currentThreshold-EVENT_CURRENT_HYSTERESIS):(c<=currentThreshold))     // no crossing
+    return;
+
+  currentAbove[track]=!currentAbove[track];
+  begin(EVENT_CURRENT);
+  INTERFACE.print('a');
+  INTERFACE.print(track);
+  INTERFACE.print(' ');
+  INTERFACE.print(int(c));
+  end();
+} // Events::current
+
+///////////////////////////////////////////////////////////////////////////////
+
+// FLETCHER-16 CHECKSUM OF ALL STATE THAT CAN BE REPORTED BY EVENTS (OTHER THAN CURRENT)
+
+#define  DIGEST_ADD(x)   {s1=(s1+(byte)(x))%255; s2=(s2+s1)%255;}
+
+unsigned int Events::digest(){
+  unsigned int s1=0, s2=0;
+  Turnout *t;
+  Output *o;
+  Sensor *s;
+
+  for(int i=0;i<=MAIN_DISTRICTS;i++)
+    DIGEST_ADD(SerialCommand::mMonitor[i].state);
+  DIGEST_ADD(SerialCommand::pMonitor->state);
+
+  for(int i=1;i<=MAX_MAIN_REGISTERS;i++){
+    DIGEST_ADD(lowByte(SerialCommand::mRegs->speedTable[i]));
+    DIGEST_ADD(highByte(SerialCommand::mRegs->speedTable[i]));
+  }
+
+  for(t=Turnout::firstTurnout;t!=NULL;t=t->nextTurnout){
+    DIGEST_ADD(lowByte(t->data.id));
+    DIGEST_ADD(highByte(t->data.id));
+    DIGEST_ADD(t->data.tStatus);
+  }
+
+  for(o=Output::firstOutput;o!=NULL;o=o->nextOutput){
+    DIGEST_ADD(lowByte(o->data.id));
+    DIGEST_ADD(highByte(o->data.id));
+    DIGEST_ADD(o->data.oStatus);
+  }
+
+  for(s=Sensor::firstSensor;s!=NULL;s=s->nextSensor){
+    DIGEST_ADD(lowByte(s->data.snum));
+    DIGEST_ADD(highByte(s->data.snum));
+    DIGEST_ADD(s->active);
+  }
+
+  return((s2<<8)|s1);
+} // Events::digest
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Events::parse(char *c){
+  int m,t;
+
+  if(Session::current==NULL){   // subscriptions belong to a session --- none when carried out by a task (e.g. replay of a recorded log, see Recorder.cpp)
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  switch(sscanf_P(c,PSTR("%d %d"),&m,&t)){
+
+    case 2:                     // argument is string with mask and current threshold
+      if(t<0 || t>1024){
+        INTERFACE.print(MSG(MSG_FAIL));
+        break;
+      }
+      currentThreshold=t;
+      memset(currentAbove,0,sizeof(currentAbove));
+      // fall through
+
+    case 1:                     // argument is string with mask only
+      Session::current->eventMask=m;
+      INTERFACE.print(MSG(MSG_OK));
+    break;
+
+    case -1:                    // no arguments
+      INTERFACE.print(F("<@"));
+      INTERFACE.print(Session::current->eventSeq);
+      INTERFACE.print(' ');
+      INTERFACE.print(digest());
+      INTERFACE.print('>');
+    break;
+  }
+} // Events::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+int Events::currentThreshold=1024;
+boolean Events::currentAbove[MAIN_DISTRICTS+2];
@@ -0,0 +1,36 @@
+/**********************************************************************
+
+Events.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Events_h
+#define Events_h
+
+#include "Arduino.h"
+#include "Config.h"
+
+#define  EVENT_SPEED      1
+#define  EVENT_TURNOUT    2
+#define  EVENT_OUTPUT     4
+#define  EVENT_SENSOR     8
+#define  EVENT_POWER      16
+#define  EVENT_CURRENT    32
+
+#define  EVENT_CURRENT_HYSTERESIS   10      // smoothed current must fall this far below the threshold before another crossing is reported
+
+struct Events{
+  static int currentThreshold;
+  static boolean currentAbove[MAIN_DISTRICTS+2];
+  static boolean begin(byte);
+  static void end();
+  static void message(byte, const char *);
+  static void current(int, float);
+  static unsigned int digest();
+  static void parse(char *c);
+}; // Events
+
+#endif
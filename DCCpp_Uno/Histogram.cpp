@@ -0,0 +1,125 @@
+/**********************************************************************
+
+Histogram.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION records how long each pass through the main loop takes, how long each run of each
+scheduled task takes (see Scheduler.cpp), how long loading a packet has to wait for the DCC signal interrupt
+to pick up a prior packet, and how long each stop reflex takes to reach the track (see Reflex.cpp), in a series of HISTOGRAMS with logarithmically-sized buckets.  Adding a duration to
+a histogram requires only a few shifts and an increment, so they may be left running on a live layout to
+determine which part of the sketch is delaying the others.
+
+To read or reset the histograms use:
+
+  <l>:          returns each histogram
+                returns: <l NAME C0 C1 ... C15> for the main loop (NAME=LOOP), each scheduled task (Mega only, to conserve
+                SRAM on the Uno, see Scheduler.h), packet loading (NAME=WAIT), and stop reflexes (NAME=REFLEX)
+
+  <l 0>:        resets all histograms to zero
+                returns: <O>
+
+where
+
+  NAME: the name of the histogram
+  C0: the number of durations of zero microseconds
+  CN: the number of durations of 2^(N-1) to 2^N-1 microseconds, except for C15 which also includes all longer durations
+
+Counts stop at 65535 rather than wrapping around to zero.
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Histogram.h"
+#include "Scheduler.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::add(unsigned long t){
+  byte n=0;
+
+  while(t>0 && n<HISTOGRAM_BUCKETS-1){            // number of significant bits in t
+    t>>=1;
+    n++;
+  }
+
+  if(count[n]<65535)
+    count[n]++;
+} // Histogram::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::show(const char *name){
+  INTERFACE.print(F("<l "));
+  INTERFACE.print(MSG(name));
+  for(int i=0;i<HISTOGRAM_BUCKETS;i++){
+    INTERFACE.print(' ');
+    INTERFACE.print(count[i]);
+  }
+  INTERFACE.print('>');
+} // Histogram::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::reset(){
+  for(int i=0;i<HISTOGRAM_BUCKETS;i++)
+    count[i]=0;
+} // Histogram::reset
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::parse(char *c){
+  int n;
+
+  switch(sscanf_P(c,PSTR("%d"),&n)){
+
+    case 1:                     // argument is zero
+      if(n==0){
+        resetAll();
+        INTERFACE.print(MSG(MSG_OK));
+      } else{
+        INTERFACE.print(MSG(MSG_FAIL));
+      }
+    break;
+
+    case -1:                    // no arguments
+      showAll();
+    break;
+  }
+} // Histogram::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::showAll(){
+  loopTime.show(PSTR("LOOP"));
+#if SCHEDULER_HISTOGRAMS
+  for(int i=0;i<Scheduler::nTasks;i++)
+    Scheduler::task[i].runTime.show(Scheduler::task[i].name);
+#endif
+  loadWait.show(PSTR("WAIT"));
+  reflexTime.show(PSTR("REFLEX"));
+} // Histogram::showAll
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Histogram::resetAll(){
+  loopTime.reset();
+#if SCHEDULER_HISTOGRAMS
+  for(int i=0;i<Scheduler::nTasks;i++)
+    Scheduler::task[i].runTime.reset();
+#endif
+  loadWait.reset();
+  reflexTime.reset();
+} // Histogram::resetAll
+
+///////////////////////////////////////////////////////////////////////////////
+
+Histogram Histogram::loopTime;
+Histogram Histogram::loadWait;
+Histogram Histogram::reflexTime;
@@ -0,0 +1,30 @@
+/**********************************************************************
+
+Histogram.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Histogram_h
+#define Histogram_h
+
+#include "Arduino.h"
+
+#define  HISTOGRAM_BUCKETS    16        // bucket N counts durations of 2^(N-1) to 2^N-1 microseconds (bucket 0 counts zero durations, last bucket also counts anything longer)
+
+struct Histogram{
+  static Histogram loopTime;
+  static Histogram loadWait;
+  static Histogram reflexTime;
+  unsigned int count[HISTOGRAM_BUCKETS];
+  void add(unsigned long);
+  void show(const char *);              // name is stored in flash, e.g. PSTR("LOOP")
+  void reset();
+  static void parse(char *c);
+  static void showAll();
+  static void resetAll();
+}; // Histogram
+
+#endif
@@ -0,0 +1,107 @@
+/**********************************************************************
+
+Messages.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+On an AVR processor, every string literal used by the sketch (e.g. "<X>") is copied from flash into SRAM at start-up
+and stays there, even if it is only ever printed.  On the Uno, with just 2048 bytes of SRAM, this memory is better used
+for Main Track Registers and for turnout, sensor, output, and route definitions.
+
+DCC++ BASE STATION therefore keeps all of its protocol replies and configuration text in flash (PROGMEM) only:
+
+  * replies used in many places (e.g. <O>, <X>, <p0>, <p1>) are kept once in the catalog below and printed with
+    INTERFACE.print(MSG(MSG_OK)) etc.
+  * replies used in only one place are printed with INTERFACE.print(F("...")), or as part of a format (see below)
+  * replies made up of text and numbers are printed with Messages::print(), which streams a format string from
+    flash directly to the output, character by character, substituting each argument in turn as follows:
+
+      %d   int
+      %u   unsigned int
+      %l   long
+      %L   unsigned long
+      %x   unsigned int, in hexidecimal
+      %c   char
+      %s   string in SRAM
+      %S   string in flash (e.g. a catalog message)
+      %%   a single %
+
+    for example: Messages::print(INTERFACE,PSTR("<H%d %d>"),id,status);
+
+No formatted text is assembled in SRAM, unlike sprintf().  Use the <F 1> command (see SerialCommand.cpp) to
+find out how much SRAM is free, and how many more Main Track Registers, turnouts, sensors, outputs, or route
+entries that would allow.
+
+**********************************************************************/
+
+#include "Messages.h"
+#include "DCCpp_Uno.h"
+#include <stdarg.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char MSG_OK[] PROGMEM = "<O>";
+const char MSG_FAIL[] PROGMEM = "<X>";
+const char MSG_POWER_OFF[] PROGMEM = "<p0>";
+const char MSG_POWER_ON[] PROGMEM = "<p1>";
+const char MSG_MAIN_OVERLOAD[] PROGMEM = "<p2>";
+const char MSG_PROG_OVERLOAD[] PROGMEM = "<p3>";
+const char MSG_MAIN_RESTORED[] PROGMEM = "<p1 MAIN>";
+const char MSG_PROG_RESTORED[] PROGMEM = "<p1 PROG>";
+const char MSG_BANNER[] PROGMEM = "<iDCC++ BASE STATION FOR ARDUINO " ARDUINO_TYPE " / " MOTOR_SHIELD_NAME ": V-" VERSION " / " __DATE__ " " __TIME__ ">";
+
+///////////////////////////////////////////////////////////////////////////////
+
+// PRINTS FORMAT STRING FMT, STORED IN FLASH, TO OUT --- SEE ABOVE FOR SUBSTITUTIONS
+
+void Messages::print(Print &out, const char *fmt, ...){
+  va_list args;
+  char c;
+
+  va_start(args,fmt);
+
+  while((c=pgm_read_byte(fmt++))!='\0'){
+    if(c!='%'){
+      out.print(c);
+      continue;
+    }
+    switch(c=pgm_read_byte(fmt++)){
+      case 'd':
+        out.print(va_arg(args,int));
+        break;
+      case 'u':
+        out.print(va_arg(args,unsigned int));
+        break;
+      case 'l':
+        out.print(va_arg(args,long));
+        break;
+      case 'L':
+        out.print(va_arg(args,unsigned long));
+        break;
+      case 'x':
+        out.print(va_arg(args,unsigned int),HEX);
+        break;
+      case 'c':
+        out.print((char)va_arg(args,int));
+        break;
+      case 's':
+        out.print(va_arg(args,char *));
+        break;
+      case 'S':
+        out.print(MSG(va_arg(args,char *)));
+        break;
+      case '\0':                          // format ended with a stray %
+        fmt--;
+        break;
+      default:                            // %% (or unknown substitution) prints the character itself
+        out.print(c);
+        break;
+    }
+  }
+
+  va_end(args);
+} // Messages::print
@@ -0,0 +1,31 @@
+/**********************************************************************
+
+Messages.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Messages_h
+#define Messages_h
+
+#include "Arduino.h"
+
+#define  MSG(m)   ((const __FlashStringHelper *)(m))     // allows a catalog message to be printed directly from flash, e.g. INTERFACE.print(MSG(MSG_OK))
+
+extern const char MSG_OK[] PROGMEM;
+extern const char MSG_FAIL[] PROGMEM;
+extern const char MSG_POWER_OFF[] PROGMEM;
+extern const char MSG_POWER_ON[] PROGMEM;
+extern const char MSG_MAIN_OVERLOAD[] PROGMEM;
+extern const char MSG_PROG_OVERLOAD[] PROGMEM;
+extern const char MSG_MAIN_RESTORED[] PROGMEM;
+extern const char MSG_PROG_RESTORED[] PROGMEM;
+extern const char MSG_BANNER[] PROGMEM;
+
+struct Messages{
+  static void print(Print &, const char *, ...);
+}; // Messages
+
+#endif
@@ -24,7 +24,7 @@ output definitions using the following variation of the "Z" command:
                                if output ID already exists, it is updated with specificed PIN and IFLAG.
                                note: output state will be immediately set to ACTIVE/INACTIVE and pin will be set to HIGH/LOW
                                according to IFLAG value specifcied (see below).
-                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory)
+                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory, or PIN does not exist)
 
   <Z ID>:                      deletes definition of output ID
                                returns: <O> if successful and <X> if unsuccessful (e.g. ID does not exist)
@@ -76,21 +76,24 @@ the state of any outputs being monitored or controlled by a separate interface o
 #include "DCCpp_Uno.h"
 #include "EEStore.h"
 #include <EEPROM.h>
+#include "Events.h"
+#include "Messages.h"
 #include "Comm.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void Output::activate(int s){
+void Output::activate(int s, int v){
   data.oStatus=(s>0);                                               // if s>0, set status to active, else inactive
   digitalWrite(data.pin,data.oStatus ^ bitRead(data.iFlag,0));      // set state of output pin to HIGH or LOW depending on whether bit zero of iFlag is set to 0 (ACTIVE=HIGH) or 1 (ACTIVE=LOW)
   if(num>0)
     EEPROM.put(num,data.oStatus);
-  INTERFACE.print("<Y");
-  INTERFACE.print(data.id);
-  if(data.oStatus==0)
-    INTERFACE.print(" 0>");
-  else
-    INTERFACE.print(" 1>"); 
+  if(Events::begin(EVENT_OUTPUT)){
+    Messages::print(INTERFACE,PSTR("Y%d %d"),data.id,data.oStatus);
+    Events::end();
+  }
+  if(v==0)
+    return;
+  Messages::print(INTERFACE,PSTR("<Y%d %d>"),data.id,data.oStatus);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,7 +111,7 @@ void Output::remove(int n){
   for(tt=firstOutput;tt!=NULL && tt->data.id!=n;pp=tt,tt=tt->nextOutput);
 
   if(tt==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
   
@@ -119,7 +122,7 @@ void Output::remove(int n){
 
   free(tt);
 
-  INTERFACE.print("<O>");
+  INTERFACE.print(MSG(MSG_OK));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -128,23 +131,15 @@ void Output::show(int n){
   Output *tt;
 
   if(firstOutput==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
     
   for(tt=firstOutput;tt!=NULL;tt=tt->nextOutput){
-    INTERFACE.print("<Y");
-    INTERFACE.print(tt->data.id);
-    if(n==1){
-      INTERFACE.print(" ");
-      INTERFACE.print(tt->data.pin);
-      INTERFACE.print(" ");
-      INTERFACE.print(tt->data.iFlag);
-    }
-    if(tt->data.oStatus==0)
-       INTERFACE.print(" 0>");
-     else
-       INTERFACE.print(" 1>"); 
+    if(n==1)
+      Messages::print(INTERFACE,PSTR("<Y%d %d %d %d>"),tt->data.id,tt->data.pin,tt->data.iFlag,tt->data.oStatus!=0);
+    else
+      Messages::print(INTERFACE,PSTR("<Y%d %d>"),tt->data.id,tt->data.oStatus!=0);
   }
 }
 
@@ -154,18 +149,21 @@ void Output::parse(char *c){
   int n,s,m;
   Output *t;
   
-  switch(sscanf(c,"%d %d %d",&n,&s,&m)){
+  switch(sscanf_P(c,PSTR("%d %d %d"),&n,&s,&m)){
     
     case 2:                     // argument is string with id number of output followed by zero (LOW) or one (HIGH)
       t=get(n);
       if(t!=NULL)
         t->activate(s);
       else
-        INTERFACE.print("<X>");
+        INTERFACE.print(MSG(MSG_FAIL));
       break;
 
     case 3:                     // argument is string with id number of output followed by a pin number and invert flag
-      create(n,s,m,1);
+      if(s<0 || s>=NUM_DIGITAL_PINS)
+        INTERFACE.print(MSG(MSG_FAIL));
+      else
+        create(n,s,m,1);
     break;
 
     case 1:                     // argument is a string with id number only
@@ -230,7 +228,7 @@ Output *Output::create(int id, int pin, int iFlag, int v){
 
   if(tt==NULL){       // problem allocating memory
     if(v==1)
-      INTERFACE.print("<X>");
+      INTERFACE.print(MSG(MSG_FAIL));
     return(tt);
   }
   
@@ -243,7 +241,7 @@ Output *Output::create(int id, int pin, int iFlag, int v){
     tt->data.oStatus=bitRead(tt->data.iFlag,1)?bitRead(tt->data.iFlag,2):0;      // sets status to 0 (INACTIVE) is bit 1 of iFlag=0, otherwise set to value of bit 2 of iFlag  
     digitalWrite(tt->data.pin,tt->data.oStatus ^ bitRead(tt->data.iFlag,0));
     pinMode(tt->data.pin,OUTPUT);
-    INTERFACE.print("<O>");
+    INTERFACE.print(MSG(MSG_OK));
   }
   
   return(tt);
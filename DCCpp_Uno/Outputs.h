@@ -24,7 +24,7 @@ struct Output{
   int num;
   struct OutputData data;
   Output *nextOutput;
-  void activate(int s);
+  void activate(int s, int=1);
   static void parse(char *c);
   static Output* get(int);
   static void remove(int);
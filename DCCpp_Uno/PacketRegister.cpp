@@ -9,7 +9,14 @@ Part of DCC++ BASE STATION for the Arduino
 
 #include "DCCpp_Uno.h"
 #include "PacketRegister.h"
+#include "Roster.h"
+#include "Clock.h"
+#include "Scheduler.h"
+#include "Histogram.h"
+#include "PacketTrace.h"
+#include "Events.h"
 #include "Comm.h"
+#include "Messages.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -31,8 +38,22 @@ RegisterList::RegisterList(int maxNumRegs){
   regMap[0]=reg;
   maxLoadedReg=reg;
   nextReg=NULL;
+  pickupReg=NULL;
+  pickupTime=0;
   currentBit=0;
   nRepeat=0;
+  lastWriteCV=0;
+  nInterrupts=0;
+  nPackets=0;
+  nLoads=0;
+  nLoadWaits=0;
+  loadWaitTime=0;
+  nOverruns=0;
+  overrunReg=0;
+  overrunBit=0;
+  deferring=false;
+  nDeferred=0;
+  deferredMax=reg;
 } // RegisterList::RegisterList
   
 ///////////////////////////////////////////////////////////////////////////////
@@ -43,12 +64,22 @@ RegisterList::RegisterList(int maxNumRegs){
 
 void RegisterList::loadPacket(int nReg, byte *b, int nBytes, int nRepeat, int printFlag) volatile {
   
-  nReg=nReg%((maxNumRegs+1));         // force nReg to be between 0 and maxNumRegs, inclusive
+  if(nReg<0 || nReg>maxNumRegs)       // callers validate nReg --- an invalid Register is ignored rather than wrapped onto another one
+    return;
 
-  while(nextReg!=NULL);               // pause while there is a Register already waiting to be updated -- nextReg will be reset to NULL by interrupt when prior Register updated fully processed
+  nLoads++;
+  if(nextReg!=NULL){                  // a Register is already waiting to be updated --- time how long it takes for interrupt to pick it up
+    unsigned long t=Clock::us();
+    nLoadWaits++;
+    while(nextReg!=NULL)              // pause while there is a Register already waiting to be updated -- nextReg will be reset to NULL by interrupt when prior Register updated fully processed
+      Scheduler::yield();             // keep critical tasks (e.g. current monitoring) running while waiting
+    t=Clock::us()-t;
+    loadWaitTime+=t;
+    Histogram::loadWait.add(t);
+  }
  
   if(regMap[nReg]==NULL)              // first time this Register Number has been called
-   regMap[nReg]=maxLoadedReg+1;       // set Register Pointer for this Register Number to next available Register
+   regMap[nReg]=max(maxLoadedReg,deferredMax)+1;     // set Register Pointer for this Register Number to next available Register (including any deferred Registers not yet committed)
  
   Register *r=regMap[nReg];           // set Register to be updated
   Packet *p=r->updatePacket;          // set Packet in the Register to be updated
@@ -87,30 +118,99 @@ void RegisterList::loadPacket(int nReg, byte *b, int nBytes, int nRepeat, int pr
     } // >4 bytes
   } // >3 bytes
   
-  nextReg=r;
-  this->nRepeat=nRepeat;
-  maxLoadedReg=max(maxLoadedReg,nextReg);
+  if(deferring && nReg>0){            // defer update of this Register until commitDeferred() is called
+    int i;
+    for(i=0;i<nDeferred && deferred[i]!=r;i++);
+    if(i==nDeferred){                 // Register is not already deferred
+      if(nDeferred==MAX_DEFERRED_REGISTERS){    // no more room --- commit those already deferred and keep deferring
+        commitDeferred();
+        deferring=true;
+      }
+      deferred[nDeferred++]=r;
+      deferredMax=max(deferredMax,r);
+    }
+  } else{
+    nextReg=r;
+    this->nRepeat=nRepeat;
+    maxLoadedReg=max(maxLoadedReg,nextReg);
+  }
   
-  if(printFlag && SHOW_PACKETS)       // for debugging purposes
-    printPacket(nReg,b,nBytes,nRepeat);  
+  if(printFlag)                       // for debugging purposes --- see PacketTrace.cpp
+    PacketTrace::add(nReg,b,nBytes,nRepeat);
 
 } // RegisterList::loadPacket
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// CAUSES ALL SUBSEQUENT PACKETS LOADED INTO REGISTERS 1 AND ABOVE TO BE HELD BACK UNTIL COMMITDEFERRED() IS CALLED,
+// SO THAT A SERIES OF THROTTLE UPDATES CAN BE PLACED ON THE TRACK TOGETHER
+
+void RegisterList::beginDeferred() volatile {
+  deferring=true;
+} // RegisterList::beginDeferred
+
+///////////////////////////////////////////////////////////////////////////////
+
+// MAKES ALL DEFERRED PACKETS ACTIVE AT ONCE.  EACH DEFERRED REGISTER HAS ITS ACTIVE AND UPDATE PACKETS FLIPPED WITH INTERRUPTS
+// DISABLED, EXCEPT FOR THE REGISTER THE INTERRUPT IS CURRENTLY TRANSMITTING, WHICH IS INSTEAD PASSED TO THE INTERRUPT AS NEXTREG
+// SO THAT ITS PACKET IS FLIPPED (AND IMMEDIATELY TRANSMITTED) ONCE THE CURRENT PACKET IS COMPLETE
+
+void RegisterList::commitDeferred() volatile {
+  Packet *p;
+
+  while(nextReg!=NULL)                // wait for any Register already waiting to be updated
+    Scheduler::yield();
+
+  noInterrupts();
+  for(int i=0;i<nDeferred;i++){
+    if(deferred[i]==currentReg){
+      nextReg=currentReg;
+      nRepeat=0;
+    } else{
+      p=deferred[i]->activePacket;
+      deferred[i]->activePacket=deferred[i]->updatePacket;
+      deferred[i]->updatePacket=p;
+    }
+  }
+  maxLoadedReg=max(maxLoadedReg,deferredMax);
+  interrupts();
+
+  deferring=false;
+  nDeferred=0;
+  deferredMax=reg;
+} // RegisterList::commitDeferred
+
+///////////////////////////////////////////////////////////////////////////////
+
 void RegisterList::setThrottle(char *s) volatile{
-  byte b[5];                          // save space for checksum byte
   int nReg;
   int cab;
   int tSpeed;
   int tDirection;
-  byte nB=0;
   
-  if(sscanf(s,"%d %d %d %d",&nReg,&cab,&tSpeed,&tDirection)!=4)
+  if(sscanf_P(s,PSTR("%d %d %d %d"),&nReg,&cab,&tSpeed,&tDirection)!=4 || setThrottle(nReg,cab,tSpeed,tDirection)!=0){
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
+  }
+
+  INTERFACE.print(F("<T"));
+  INTERFACE.print(nReg); INTERFACE.print(' ');
+  INTERFACE.print(max(tSpeed,0)); INTERFACE.print(' ');
+  INTERFACE.print(tDirection);
+  INTERFACE.print('>');
+    
+} // RegisterList::setThrottle()
 
-  if(nReg<1 || nReg>maxNumRegs)
-    return;  
+///////////////////////////////////////////////////////////////////////////////
+
+// LOADS THROTTLE PACKET AND RETURNS 0, OR RETURNS 1 IF REGISTER IS INVALID
+
+int RegisterList::setThrottle(int nReg, int cab, int tSpeed, int tDirection) volatile{
+  byte b[5];                          // save space for checksum byte
+  byte nB=0;
+  
+  if(nReg<1 || nReg>maxNumRegs || cab<0 || cab>10293 || tSpeed<-1 || tSpeed>126 || tDirection<0 || tDirection>1)
+    return(1);  
 
   if(cab>127)
     b[nB++]=highByte(cab) | 0xC0;     // convert train number into a two-byte address
@@ -126,36 +226,51 @@ void RegisterList::setThrottle(char *s) volatile{
        
   loadPacket(nReg,b,nB,0,1);
   
-  INTERFACE.print("<T");
-  INTERFACE.print(nReg); INTERFACE.print(" ");
-  INTERFACE.print(tSpeed); INTERFACE.print(" ");
-  INTERFACE.print(tDirection);
-  INTERFACE.print(">");
-  
   speedTable[nReg]=tDirection==1?tSpeed:-tSpeed;
+
+  if(Events::begin(EVENT_SPEED)){
+    INTERFACE.print('T');
+    INTERFACE.print(nReg); INTERFACE.print(' ');
+    INTERFACE.print(tSpeed); INTERFACE.print(' ');
+    INTERFACE.print(tDirection);
+    Events::end();
+  }
+
+  return(0);
     
 } // RegisterList::setThrottle()
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void RegisterList::setFunction(char *s) volatile{
-  byte b[5];                          // save space for checksum byte
   int cab;
   int fByte, eByte;
   int nParams;
-  byte nB=0;
   
-  nParams=sscanf(s,"%d %d %d",&cab,&fByte,&eByte);
+  nParams=sscanf_P(s,PSTR("%d %d %d"),&cab,&fByte,&eByte);
   
-  if(nParams<2)
-    return;
+  if(nParams<2 || setFunction(cab,fByte,(nParams==2)?-1:eByte)!=0)
+    INTERFACE.print(MSG(MSG_FAIL));
+    
+} // RegisterList::setFunction()
+
+///////////////////////////////////////////////////////////////////////////////
+
+// LOADS FUNCTION PACKET (EBYTE<0 FOR FUNCTIONS FL,F1-F12) AND RETURNS 0, OR RETURNS 1 IF CAB IS INVALID
+
+int RegisterList::setFunction(int cab, int fByte, int eByte) volatile{
+  byte b[5];                          // save space for checksum byte
+  byte nB=0;
+
+  if(cab<0 || cab>10293)
+    return(1);
 
   if(cab>127)
     b[nB++]=highByte(cab) | 0xC0;     // convert train number into a two-byte address
     
   b[nB++]=lowByte(cab);
 
-  if(nParams==2){                     // this is a request for functions FL,F1-F12  
+  if(eByte<0){                        // this is a request for functions FL,F1-F12  
     b[nB++]=(fByte | 0x80) & 0xBF;    // for safety this guarantees that first nibble of function byte will always be of binary form 10XX which should always be the case for FL,F1-F12  
   } else {                            // this is a request for functions F13-F28
     b[nB++]=(fByte | 0xDE) & 0xDF;    // for safety this guarantees that first byte will either be 0xDE (for F13-F20) or 0xDF (for F21-F28)
@@ -163,24 +278,39 @@ void RegisterList::setFunction(char *s) volatile{
   }
     
   loadPacket(0,b,nB,4,1);
+
+  return(0);
     
 } // RegisterList::setFunction()
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void RegisterList::setAccessory(char *s) volatile{
-  byte b[3];                          // save space for checksum byte
   int aAdd;                           // the accessory address (0-511 = 9 bits) 
   int aNum;                           // the accessory number within that address (0-3)
   int activate;                       // flag indicated whether accessory should be activated (1) or deactivated (0) following NMRA recommended convention
   
-  if(sscanf(s,"%d %d %d",&aAdd,&aNum,&activate)!=3)
-    return;
+  if(sscanf_P(s,PSTR("%d %d %d"),&aAdd,&aNum,&activate)!=3 || setAccessory(aAdd,aNum,activate)!=0)
+    INTERFACE.print(MSG(MSG_FAIL));
+      
+} // RegisterList::setAccessory()
+
+///////////////////////////////////////////////////////////////////////////////
+
+// LOADS ACCESSORY PACKET AND RETURNS 0, OR RETURNS 1 IF ADDRESS, SUBADDRESS, OR ACTIVATE IS OUT OF RANGE
+
+int RegisterList::setAccessory(int aAdd, int aNum, int activate) volatile{
+  byte b[3];                          // save space for checksum byte
+
+  if(aAdd<0 || aAdd>511 || aNum<0 || aNum>3 || activate<0 || activate>1)
+    return(1);
     
   b[0]=aAdd%64+128;                                             // first byte is of the form 10AAAAAA, where AAAAAA represent 6 least signifcant bits of accessory address  
   b[1]=((((aAdd/64)%8)<<4) + (aNum%4<<1) + activate%2) ^ 0xF8;  // second byte is of the form 1AAACDDD, where C should be 1, and the least significant D represent activate/deactivate
       
   loadPacket(0,b,2,4,1);
+
+  return(0);
       
 } // RegisterList::setAccessory()
 
@@ -189,14 +319,21 @@ void RegisterList::setAccessory(char *s) volatile{
 void RegisterList::writeTextPacket(char *s) volatile{
   
   int nReg;
+  unsigned int h[5];                  // %x stores an unsigned int, so bytes are first read into h and then range-checked
   byte b[6];
   int nBytes;
-  volatile RegisterList *regs;
     
-  nBytes=sscanf(s,"%d %x %x %x %x %x",&nReg,b,b+1,b+2,b+3,b+4)-1;
+  nBytes=sscanf_P(s,PSTR("%d %x %x %x %x %x"),&nReg,h,h+1,h+2,h+3,h+4)-1;
   
-  if(nBytes<2 || nBytes>5){    // invalid valid packet
-    INTERFACE.print("<mInvalid Packet>");
+  for(int i=0;i<nBytes && nBytes<=5;i++){
+    if(h[i]>0xFF)
+      nBytes=-1;
+    else
+      b[i]=h[i];
+  }
+
+  if(nBytes<2 || nBytes>5 || nReg<0 || nReg>maxNumRegs){    // invalid valid packet
+    INTERFACE.print(F("<mInvalid Packet>"));
     return;
   }
          
@@ -206,95 +343,241 @@ void RegisterList::writeTextPacket(char *s) volatile{
   
 ///////////////////////////////////////////////////////////////////////////////
 
-void RegisterList::readCV(char *s) volatile{
+void RegisterList::ackBase(AckDetector &ack) volatile{
+
+  ack.begin();
+  for(int j=0;j<ACK_BASE_COUNT;j++)
+    ack.baseSample(analogRead(CURRENT_MONITOR_PIN_PROG));
+
+} // RegisterList::ackBase()
+
+///////////////////////////////////////////////////////////////////////////////
+
+// SENDS A 3-BYTE SERVICE MODE VERIFY PACKET (BIT OR BYTE) AND RETURNS 1 IF THE DECODER ACKNOWLEDGED IT, OR 0 IF NOT
+// ACK MUST ALREADY CONTAIN THE BASELINE CURRENT (FROM ackBase) AGAINST WHICH THE ACKNOWLEDGEMENT PULSE IS MEASURED
+
+int RegisterList::verifyAck(byte *b, AckDetector &ack) volatile{
+  int d;
+
+  ack.arm();
+
+  loadPacket(0,resetPacket,2,3);          // NMRA recommends starting with 3 reset packets
+  loadPacket(0,b,3,5);                    // NMRA recommends 5 verfy packets
+  loadPacket(0,resetPacket,2,1);          // forces code to wait until all repeats of b are completed (and decoder begins to respond)
+
+  while((d=ack.sample(analogRead(CURRENT_MONITOR_PIN_PROG)))==ACK_PENDING)      // sample only until acknowledgement is confirmed or ruled out
+    Scheduler::yield();
+
+  return(d);
+} // RegisterList::verifyAck()
+
+///////////////////////////////////////////////////////////////////////////////
+
+// READS CV (1-1024) FROM THE DECODER ON THE PROGRAMMING TRACK
+// IF A LIST OF CANDIDATE VALUES (HINTS) IS PROVIDED, EACH IS FIRST TRIED WITH A SINGLE BYTE-VERIFY, AND THE FIRST ONE ACKNOWLEDGED IS RETURNED
+// OTHERWISE THE VALUE IS DETERMINED USING 8 BIT-VERIFIES FOLLOWED BY A BYTE-VERIFY
+// RETURNS THE VALUE OF THE CV (0-255), OR -1 IF THE VALUE COULD NOT BE VERIFIED
+
+int RegisterList::readCVValue(int cv, int *hints, int nHints) volatile{
   byte bRead[4];
   int bValue;
-  int c,d,base;
-  int cv, callBack, callBackSub;
+  AckDetector ack;
+  int i,j;
+
+  if(cv<1 || cv>1024)                // no such CV --- treat as a failed read
+    return(-1);
 
-  if(sscanf(s,"%d %d %d",&cv,&callBack,&callBackSub)!=3)          // cv = 1-1024
-    return;    
   cv--;                              // actual CV addresses are cv-1 (0-1023)
-  
-  bRead[0]=0x78+(highByte(cv)&0x03); // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+
   bRead[1]=lowByte(cv);
-  
-  bValue=0;
-  
-  for(int i=0;i<8;i++){
-    
-    c=0;
-    d=0;
-    base=0;
 
-    for(int j=0;j<ACK_BASE_COUNT;j++)
-      base+=analogRead(CURRENT_MONITOR_PIN_PROG);
-    base/=ACK_BASE_COUNT;
+  ackBase(ack);                      // baseline current is established once for all verifies of this CV
 
-    bRead[2]=0xE8+i;  
+  bRead[0]=0x74+(highByte(cv)&0x03);      // set-up to verify entire byte against each candidate value
 
-    loadPacket(0,resetPacket,2,3);          // NMRA recommends starting with 3 reset packets
-    loadPacket(0,bRead,3,5);                // NMRA recommends 5 verfy packets
-    loadPacket(0,resetPacket,2,1);          // forces code to wait until all repeats of bRead are completed (and decoder begins to respond)
+  for(i=0;i<nHints;i++){
+    for(j=0;j<i && hints[j]!=hints[i];j++);
+    if(j<i || hints[i]<0 || hints[i]>255)           // skip duplicate or invalid candidates
+      continue;
+    bRead[2]=hints[i];
+    if(verifyAck(bRead,ack))
+      return(hints[i]);
+  }
 
-    for(int j=0;j<ACK_SAMPLE_COUNT;j++){
-      c=(analogRead(CURRENT_MONITOR_PIN_PROG)-base)*ACK_SAMPLE_SMOOTHING+c*(1.0-ACK_SAMPLE_SMOOTHING);
-      if(c>ACK_SAMPLE_THRESHOLD)
-        d=1;
-    }
+  bRead[0]=0x78+(highByte(cv)&0x03); // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  bValue=0;
 
-    bitWrite(bValue,i,d);
+  for(i=0;i<8;i++){
+    bRead[2]=0xE8+i;
+    bitWrite(bValue,i,verifyAck(bRead,ack));
   }
-    
-  c=0;
-  d=0;
-  base=0;
 
-  for(int j=0;j<ACK_BASE_COUNT;j++)
-    base+=analogRead(CURRENT_MONITOR_PIN_PROG);
-  base/=ACK_BASE_COUNT;
-  
   bRead[0]=0x74+(highByte(cv)&0x03);      // set-up to re-verify entire byte
-  bRead[2]=bValue;  
+  bRead[2]=bValue;
 
-  loadPacket(0,resetPacket,2,3);          // NMRA recommends starting with 3 reset packets
-  loadPacket(0,bRead,3,5);                // NMRA recommends 5 verfy packets
-  loadPacket(0,resetPacket,2,1);          // forces code to wait until all repeats of bRead are completed (and decoder begins to respond)
-    
-  for(int j=0;j<ACK_SAMPLE_COUNT;j++){
-    c=(analogRead(CURRENT_MONITOR_PIN_PROG)-base)*ACK_SAMPLE_SMOOTHING+c*(1.0-ACK_SAMPLE_SMOOTHING);
-    if(c>ACK_SAMPLE_THRESHOLD)
-      d=1;
-  }
-    
-  if(d==0)    // verify unsuccessful
+  if(!verifyAck(bRead,ack))              // verify unsuccessful
     bValue=-1;
 
-  INTERFACE.print("<r");
+  return(bValue);
+} // RegisterList::readCVValue()
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS A LIST OF CANDIDATE VALUES FOR CV IN H, MADE UP OF THE VALUE MOST RECENTLY WRITTEN TO CV ON THE PROGRAMMING TRACK (IF ANY),
+// FOLLOWED BY VALUES CACHED IN THE ROSTER FOR DECODERS MATCHING MFR AND VERSION (-1 MATCHES ANY).  RETURNS THE NUMBER OF CANDIDATES
+
+int RegisterList::readHints(int cv, int mfr, int version, int *h) volatile{
+  int n=0;
+
+  if(cv==lastWriteCV && lastWriteValue>=0)
+    h[n++]=lastWriteValue;
+
+  return(Roster::hints(cv,mfr,version,h,n));
+} // RegisterList::readHints()
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RegisterList::readCV(char *s) volatile{
+  int bValue;
+  int cv, callBack, callBackSub;
+  int h[ROSTER_MAX_HINTS+1];
+  int nHints;
+
+  nHints=sscanf_P(s,PSTR("%d %d %d %d %d %d %d"),&cv,&callBack,&callBackSub,h,h+1,h+2,h+3)-3;          // cv = 1-1024
+
+  if(nHints<0)
+    return;    
+
+  if(nHints==0 && cv==lastWriteCV && lastWriteValue>=0)           // no candidates provided --- try value just written
+    h[nHints++]=lastWriteValue;
+
+  bValue=readCVValue(cv,h,nHints);
+
+  INTERFACE.print(F("<r"));
   INTERFACE.print(callBack);
-  INTERFACE.print("|");
+  INTERFACE.print('|');
   INTERFACE.print(callBackSub);
-  INTERFACE.print("|");
-  INTERFACE.print(cv+1);
-  INTERFACE.print(" ");
+  INTERFACE.print('|');
+  INTERFACE.print(cv);
+  INTERFACE.print(' ');
   INTERFACE.print(bValue);
-  INTERFACE.print(">");
+  INTERFACE.print('>');
         
 } // RegisterList::readCV()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void RegisterList::readCVBatch(char *s) volatile{
+  int cv[ROSTER_MAX_BATCH];
+  int bValue[ROSTER_MAX_BATCH];
+  int idCV[5], idValue[5];                // CVs read while identifying the decoder, which are re-used if also requested
+  int h[ROSTER_MAX_HINTS];
+  int nCVs, nId=0, nCached=0, nHints, cached;
+  int callBack, callBackSub;
+  int mfr, version, cv29, address;
+  Roster *r=NULL;
+  unsigned long t=Clock::ms();
+  int i,j;
+
+  nCVs=sscanf_P(s,PSTR("%d %d %d %d %d %d %d %d %d %d"),&callBack,&callBackSub,cv,cv+1,cv+2,cv+3,cv+4,cv+5,cv+6,cv+7)-2;
+
+  if(nCVs<0)
+    return;
+
+  if(nCVs==0){                            // no CVs requested --- just identify the decoder
+    cv[nCVs++]=1;
+    cv[nCVs++]=7;
+    cv[nCVs++]=8;
+    cv[nCVs++]=29;
+  }
+
+  // identify decoder by manufacturer, version, and active address --- values cached for previously-identified decoders
+  // are tried first with a single byte-verify, so a decoder that is already in the roster can be identified very quickly
+
+  nHints=readHints(8,-1,-1,h);
+  idCV[nId]=8;  idValue[nId++]=mfr=readCVValue(8,h,nHints);
+  nHints=readHints(7,mfr,-1,h);
+  idCV[nId]=7;  idValue[nId++]=version=readCVValue(7,h,nHints);
+
+  nHints=readHints(29,mfr,version,h);
+  if(nHints<ROSTER_MAX_HINTS)             // common factory default: 28/128 speed steps with analog operation enabled
+    h[nHints++]=6;
+  if(nHints<ROSTER_MAX_HINTS)             // same, but using long address
+    h[nHints++]=38;
+  idCV[nId]=29; idValue[nId++]=cv29=readCVValue(29,h,nHints);
+
+  if(cv29<0){
+    address=-1;
+  } else if(bitRead(cv29,5)){                                // decoder is using long address in CV17/CV18
+    nHints=readHints(17,mfr,version,h);
+    idCV[nId]=17; idValue[nId++]=readCVValue(17,h,nHints);
+    nHints=readHints(18,mfr,version,h);
+    idCV[nId]=18; idValue[nId++]=readCVValue(18,h,nHints);
+    address=(idValue[3]<0 || idValue[4]<0)?-1:((idValue[3]&0x3F)<<8)+idValue[4];
+  } else{                                                    // decoder is using short address in CV1
+    nHints=readHints(1,mfr,version,h);
+    idCV[nId]=1; idValue[nId++]=address=readCVValue(1,h,nHints);
+  }
+
+  if(mfr>=0 && version>=0 && address>=0)                     // only use roster if decoder was positively identified
+    r=Roster::add(mfr,version,address,cv29);
+
+  for(i=0;i<nCVs;i++){
+    for(j=0;j<nId && idCV[j]!=cv[i];j++);
+    if(j<nId){                                               // CV was already read during identification
+      bValue[i]=idValue[j];
+    } else{                                                  // CV must be read --- cached values are only tried as candidates, never returned unverified (see Roster.cpp)
+      cached=(r!=NULL)?r->get(cv[i]):-1;
+      nHints=readHints(cv[i],mfr,version,h);
+      bValue[i]=readCVValue(cv[i],h,nHints);
+      if(cached>=0 && bValue[i]==cached)                     // value cached for this decoder was confirmed
+        nCached++;
+      else if(r!=NULL && bValue[i]>=0)
+        r->put(cv[i],bValue[i]);
+    }
+  }
+
+  t=Clock::ms()-t;
+
+  INTERFACE.print(F("<j"));
+  INTERFACE.print(callBack);
+  INTERFACE.print('|');
+  INTERFACE.print(callBackSub);
+  INTERFACE.print('|');
+  INTERFACE.print(address);
+  INTERFACE.print(' ');
+  INTERFACE.print(mfr);
+  INTERFACE.print(' ');
+  INTERFACE.print(version);
+  for(i=0;i<nCVs;i++){
+    INTERFACE.print('|');
+    INTERFACE.print(cv[i]);
+    INTERFACE.print(' ');
+    INTERFACE.print(bValue[i]);
+  }
+  INTERFACE.print('|');
+  INTERFACE.print(nCached);
+  INTERFACE.print(' ');
+  INTERFACE.print(t);
+  INTERFACE.print('>');
+
+} // RegisterList::readCVBatch()
+
+///////////////////////////////////////////////////////////////////////////////
+
 void RegisterList::writeCVByte(char *s) volatile{
   byte bWrite[4];
   int bValue;
-  int c,d,base;
+  AckDetector ack;
   int cv, callBack, callBackSub;
 
-  if(sscanf(s,"%d %d %d %d",&cv,&bValue,&callBack,&callBackSub)!=4)          // cv = 1-1024
-    return;    
+  if(sscanf_P(s,PSTR("%d %d %d %d"),&cv,&bValue,&callBack,&callBackSub)!=4 || cv<1 || cv>1024 || bValue<0 || bValue>255){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
   cv--;                                 // actual CV addresses are cv-1 (0-1023)
   
-  bWrite[0]=0x7C+(highByte(cv)&0x03);   // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  bWrite[0]=0x7C+(highByte(cv)&0x03);
   bWrite[1]=lowByte(cv);
   bWrite[2]=bValue;
 
@@ -303,38 +586,27 @@ void RegisterList::writeCVByte(char *s) volatile{
   loadPacket(0,resetPacket,2,1);
   loadPacket(0,idlePacket,2,10);
 
-  c=0;
-  d=0;
-  base=0;
+  Roster::invalidate(cv+1);               // any cached copy of this CV may no longer be accurate
 
-  for(int j=0;j<ACK_BASE_COUNT;j++)
-    base+=analogRead(CURRENT_MONITOR_PIN_PROG);
-  base/=ACK_BASE_COUNT;
+  ackBase(ack);
   
   bWrite[0]=0x74+(highByte(cv)&0x03);     // set-up to re-verify entire byte
 
-  loadPacket(0,resetPacket,2,3);          // NMRA recommends starting with 3 reset packets
-  loadPacket(0,bWrite,3,5);               // NMRA recommends 5 verfy packets
-  loadPacket(0,resetPacket,2,1);          // forces code to wait until all repeats of bRead are completed (and decoder begins to respond)
-    
-  for(int j=0;j<ACK_SAMPLE_COUNT;j++){
-    c=(analogRead(CURRENT_MONITOR_PIN_PROG)-base)*ACK_SAMPLE_SMOOTHING+c*(1.0-ACK_SAMPLE_SMOOTHING);
-    if(c>ACK_SAMPLE_THRESHOLD)
-      d=1;
-  }
-    
-  if(d==0)    // verify unsuccessful
+  if(!verifyAck(bWrite,ack))             // verify unsuccessful
     bValue=-1;
 
-  INTERFACE.print("<r");
+  lastWriteCV=cv+1;                       // remember value so that a subsequent read of this CV can be verified in a single step
+  lastWriteValue=bValue;
+
+  INTERFACE.print(F("<r"));
   INTERFACE.print(callBack);
-  INTERFACE.print("|");
+  INTERFACE.print('|');
   INTERFACE.print(callBackSub);
-  INTERFACE.print("|");
+  INTERFACE.print('|');
   INTERFACE.print(cv+1);
-  INTERFACE.print(" ");
+  INTERFACE.print(' ');
   INTERFACE.print(bValue);
-  INTERFACE.print(">");
+  INTERFACE.print('>');
 
 } // RegisterList::writeCVByte()
   
@@ -343,16 +615,16 @@ void RegisterList::writeCVByte(char *s) volatile{
 void RegisterList::writeCVBit(char *s) volatile{
   byte bWrite[4];
   int bNum,bValue;
-  int c,d,base;
+  AckDetector ack;
   int cv, callBack, callBackSub;
 
-  if(sscanf(s,"%d %d %d %d %d",&cv,&bNum,&bValue,&callBack,&callBackSub)!=5)          // cv = 1-1024
-    return;    
+  if(sscanf_P(s,PSTR("%d %d %d %d %d"),&cv,&bNum,&bValue,&callBack,&callBackSub)!=5 || cv<1 || cv>1024 || bNum<0 || bNum>7 || bValue<0 || bValue>1){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
   cv--;                                 // actual CV addresses are cv-1 (0-1023)
-  bValue=bValue%2;
-  bNum=bNum%8;
   
-  bWrite[0]=0x78+(highByte(cv)&0x03);   // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  bWrite[0]=0x78+(highByte(cv)&0x03);
   bWrite[1]=lowByte(cv);  
   bWrite[2]=0xF0+bValue*8+bNum;
 
@@ -361,40 +633,28 @@ void RegisterList::writeCVBit(char *s) volatile{
   loadPacket(0,resetPacket,2,1);
   loadPacket(0,idlePacket,2,10);
 
-  c=0;
-  d=0;
-  base=0;
+  Roster::invalidate(cv+1);               // any cached copy of this CV may no longer be accurate
+  if(lastWriteCV==cv+1)
+    lastWriteCV=0;
 
-  for(int j=0;j<ACK_BASE_COUNT;j++)
-    base+=analogRead(CURRENT_MONITOR_PIN_PROG);
-  base/=ACK_BASE_COUNT;
+  ackBase(ack);
   
   bitClear(bWrite[2],4);                  // change instruction code from Write Bit to Verify Bit
 
-  loadPacket(0,resetPacket,2,3);          // NMRA recommends starting with 3 reset packets
-  loadPacket(0,bWrite,3,5);               // NMRA recommends 5 verfy packets
-  loadPacket(0,resetPacket,2,1);          // forces code to wait until all repeats of bRead are completed (and decoder begins to respond)
-    
-  for(int j=0;j<ACK_SAMPLE_COUNT;j++){
-    c=(analogRead(CURRENT_MONITOR_PIN_PROG)-base)*ACK_SAMPLE_SMOOTHING+c*(1.0-ACK_SAMPLE_SMOOTHING);
-    if(c>ACK_SAMPLE_THRESHOLD)
-      d=1;
-  }
-    
-  if(d==0)    // verify unsuccessful
+  if(!verifyAck(bWrite,ack))             // verify unsuccessful
     bValue=-1;
   
-  INTERFACE.print("<r");
+  INTERFACE.print(F("<r"));
   INTERFACE.print(callBack);
-  INTERFACE.print("|");
+  INTERFACE.print('|');
   INTERFACE.print(callBackSub);
-  INTERFACE.print("|");
+  INTERFACE.print('|');
   INTERFACE.print(cv+1);
-  INTERFACE.print(" ");
+  INTERFACE.print(' ');
   INTERFACE.print(bNum);
-  INTERFACE.print(" ");
+  INTERFACE.print(' ');
   INTERFACE.print(bValue);
-  INTERFACE.print(">");
+  INTERFACE.print('>');
 
 } // RegisterList::writeCVBit()
   
@@ -407,20 +667,24 @@ void RegisterList::writeCVByteMain(char *s) volatile{
   int bValue;
   byte nB=0;
   
-  if(sscanf(s,"%d %d %d",&cab,&cv,&bValue)!=3)
+  if(sscanf_P(s,PSTR("%d %d %d"),&cab,&cv,&bValue)!=3 || cab<0 || cab>10293 || cv<1 || cv>1024 || bValue<0 || bValue>255){
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
+  }
   cv--;
 
   if(cab>127)    
     b[nB++]=highByte(cab) | 0xC0;     // convert train number into a two-byte address
     
   b[nB++]=lowByte(cab);
-  b[nB++]=0xEC+(highByte(cv)&0x03);   // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  b[nB++]=0xEC+(highByte(cv)&0x03);
   b[nB++]=lowByte(cv);
   b[nB++]=bValue;
     
   loadPacket(0,b,nB,4);
 
+  Roster::invalidate(cv+1);           // the decoder may also have been read on the programming track
+
 } // RegisterList::writeCVByteMain()
   
 ///////////////////////////////////////////////////////////////////////////////
@@ -433,40 +697,25 @@ void RegisterList::writeCVBitMain(char *s) volatile{
   int bValue;
   byte nB=0;
   
-  if(sscanf(s,"%d %d %d %d",&cab,&cv,&bNum,&bValue)!=4)
+  if(sscanf_P(s,PSTR("%d %d %d %d"),&cab,&cv,&bNum,&bValue)!=4 || cab<0 || cab>10293 || cv<1 || cv>1024 || bNum<0 || bNum>7 || bValue<0 || bValue>1){
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
+  }
   cv--;
-    
-  bValue=bValue%2;
-  bNum=bNum%8; 
 
   if(cab>127)    
     b[nB++]=highByte(cab) | 0xC0;     // convert train number into a two-byte address
   
   b[nB++]=lowByte(cab);
-  b[nB++]=0xE8+(highByte(cv)&0x03);   // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  b[nB++]=0xE8+(highByte(cv)&0x03);
   b[nB++]=lowByte(cv);
   b[nB++]=0xF0+bValue*8+bNum;
     
   loadPacket(0,b,nB,4);
-  
-} // RegisterList::writeCVBitMain()
-
-///////////////////////////////////////////////////////////////////////////////
 
-void RegisterList::printPacket(int nReg, byte *b, int nBytes, int nRepeat) volatile {
+  Roster::invalidate(cv+1);           // the decoder may also have been read on the programming track
   
-  INTERFACE.print("<*");
-  INTERFACE.print(nReg);
-  INTERFACE.print(":");
-  for(int i=0;i<nBytes;i++){
-    INTERFACE.print(" ");
-    INTERFACE.print(b[i],HEX);
-  }
-  INTERFACE.print(" / ");
-  INTERFACE.print(nRepeat);
-  INTERFACE.print(">");
-} // RegisterList::printPacket()
+} // RegisterList::writeCVBitMain()
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -11,13 +11,9 @@ Part of DCC++ BASE STATION for the Arduino
 #define PacketRegister_h
 
 #include "Arduino.h"
+#include "AckDetector.h"
 
-// Define constants used for reading CVs from the Programming Track
-
-#define  ACK_BASE_COUNT            100      // number of analogRead samples to take before each CV verify to establish a baseline current
-#define  ACK_SAMPLE_COUNT          500      // number of analogRead samples to take when monitoring current after a CV verify (bit or byte) has been sent 
-#define  ACK_SAMPLE_SMOOTHING      0.2      // exponential smoothing to use in processing the analogRead samples after a CV verify (bit or byte) has been sent
-#define  ACK_SAMPLE_THRESHOLD       30      // the threshold that the exponentially-smoothed analogRead samples (after subtracting the baseline current) must cross to establish ACKNOWLEDGEMENT
+#define  MAX_DEFERRED_REGISTERS  8     // maximum number of Register updates held back at once by beginDeferred()
 
 // Define a series of registers that can be sequentially accessed over a loop to generate a repeating series of DCC Packets
 
@@ -30,6 +26,7 @@ struct Register{
   Packet packet[2];
   Packet *activePacket;
   Packet *updatePacket;
+  unsigned int nSent;                 // number of packets transmitted from this Register (see Counters.cpp)
   void initPackets();
 }; // Register
   
@@ -40,25 +37,50 @@ struct RegisterList{
   Register *currentReg;
   Register *maxLoadedReg;
   Register *nextReg;
+  Register *pickupReg;                // most recent Register picked up from nextReg by the DCC signal interrupt, and the Clock::us() at which it was (see Reflex.cpp)
+  unsigned long pickupTime;
   Packet  *tempPacket;
   byte currentBit;
   byte nRepeat;
   int *speedTable;
+  int lastWriteCV;
+  int lastWriteValue;
+  unsigned long nInterrupts;          // performance counters (see Counters.cpp)
+  unsigned long nPackets;
+  unsigned long nLoads;
+  unsigned long nLoadWaits;
+  unsigned long loadWaitTime;
+  unsigned int nOverruns;             // number of DCC signal interrupts that occured too late to set the next bit in time
+  byte overrunReg;                    // register and bit being transmitted at time of most recent overrun
+  byte overrunBit;
+  boolean deferring;                  // Register updates deferred until commitDeferred() (see PacketRegister.cpp)
+  byte nDeferred;
+  Register *deferred[MAX_DEFERRED_REGISTERS];
+  Register *deferredMax;
   static byte idlePacket[];
   static byte resetPacket[];
   static byte bitMask[];
   RegisterList(int);
   void loadPacket(int, byte *, int, int, int=0) volatile;
+  void beginDeferred() volatile;
+  void commitDeferred() volatile;
   void setThrottle(char *) volatile;
+  int setThrottle(int, int, int, int) volatile;
   void setFunction(char *) volatile;  
+  int setFunction(int, int, int) volatile;
   void setAccessory(char *) volatile;
+  int setAccessory(int, int, int) volatile;
   void writeTextPacket(char *) volatile;
+  void ackBase(AckDetector &) volatile;
+  int verifyAck(byte *, AckDetector &) volatile;
+  int readCVValue(int, int *, int) volatile;
+  int readHints(int, int, int, int *) volatile;
   void readCV(char *) volatile;
+  void readCVBatch(char *) volatile;
   void writeCVByte(char *) volatile;
   void writeCVBit(char *) volatile;
   void writeCVByteMain(char *) volatile;
   void writeCVBitMain(char *s) volatile;  
-  void printPacket(int, byte *, int, int) volatile;
 };
 
 #endif
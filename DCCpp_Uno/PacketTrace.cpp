@@ -0,0 +1,116 @@
+/**********************************************************************
+
+PacketTrace.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION keeps a TRACE of the most recent packets loaded into the main operations track registers
+by select commands (throttle, function, accessory, and <M> commands).  Each packet is stored as a compact
+binary record in a ring of PACKET_TRACE_SIZE records, so that tracing costs only a short copy and can be left
+running without changing the timing of the sketch.  Once the ring is full, the oldest record is overwritten.
+
+To read the trace use:
+
+  <*>:          returns each packet in the trace, oldest first, leaving the trace unchanged
+                returns: <* REG: B1 B2 ... Bn CSUM / REPEAT @ TIME> for each packet, followed by <* DROPPED>
+
+where
+
+  REG: the number of the main operations track packet register that was modified
+  B1: the first hexidecimal byte of the DCC packet
+  B2: the second hexidecimal byte of the DCC packet
+  Bn: the nth hexidecimal byte of the DCC packet
+  CSUM: a checksum byte that is required to be the final byte in any DCC packet
+  REPEAT: the number of times the DCC packet was re-transmitted to the tracks after its iniital transmission
+  TIME: the time the packet was loaded, in microseconds since start-up (see Clock.cpp)
+  DROPPED: the number of packets overwritten before they were printed, since the previous <*> command
+
+If SHOW_PACKETS is set to 1 in DCCpp_Uno.h, each packet is additionally printed in the same format, and removed
+from the trace, from a low-priority scheduled task, rather than from within the command that loaded it.  A packet
+then counts as DROPPED only if it is overwritten before that task prints it.  Otherwise, since <*> leaves the trace
+unchanged, a packet counts as DROPPED only if it is overwritten before any <*> command has printed it --- a full
+trace that is simply being refreshed with new packets after a <*> does not add to DROPPED.
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "PacketTrace.h"
+#include "Clock.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PacketTrace::add(int nReg, byte *b, int nBytes, int nRepeat){
+  PacketTraceRecord *r=trace+head;
+
+  r->time=Clock::us();
+  r->nReg=nReg;
+  r->nRepeat=nRepeat;
+  r->nBytes=min(nBytes,6);
+  memcpy(r->b,b,r->nBytes);
+
+  head=(head+1)%PACKET_TRACE_SIZE;
+  if(count<PACKET_TRACE_SIZE)
+    count++;
+#if SHOW_PACKETS
+  else
+    nDropped++;                                     // oldest record was overwritten before drain() printed it
+#else
+  if(nUnshown<PACKET_TRACE_SIZE)
+    nUnshown++;
+  else
+    nDropped++;                                     // oldest record was overwritten before <*> printed it
+#endif
+} // PacketTrace::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PacketTrace::print(PacketTraceRecord *r){
+  INTERFACE.print(F("<*"));
+  INTERFACE.print(r->nReg);
+  INTERFACE.print(':');
+  for(int i=0;i<r->nBytes;i++){
+    INTERFACE.print(' ');
+    INTERFACE.print(r->b[i],HEX);
+  }
+  INTERFACE.print(F(" / "));
+  INTERFACE.print(r->nRepeat);
+  INTERFACE.print(F(" @ "));
+  INTERFACE.print(r->time);
+  INTERFACE.print('>');
+} // PacketTrace::print
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PacketTrace::drain(){                          // print and remove oldest record, if any
+  if(count==0)
+    return;
+  print(trace+(head+PACKET_TRACE_SIZE-count)%PACKET_TRACE_SIZE);
+  count--;
+} // PacketTrace::drain
+
+///////////////////////////////////////////////////////////////////////////////
+
+void PacketTrace::show(){
+  for(int i=count;i>0;i--)
+    print(trace+(head+PACKET_TRACE_SIZE-i)%PACKET_TRACE_SIZE);
+
+  INTERFACE.print(F("<* "));
+  INTERFACE.print(nDropped);
+  INTERFACE.print('>');
+
+  nUnshown=0;                                       // every record in the trace has now been printed
+  nDropped=0;
+} // PacketTrace::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+PacketTraceRecord PacketTrace::trace[PACKET_TRACE_SIZE];
+byte PacketTrace::head=0;
+byte PacketTrace::count=0;
+byte PacketTrace::nUnshown=0;
+unsigned int PacketTrace::nDropped=0;
@@ -0,0 +1,43 @@
+/**********************************************************************
+
+PacketTrace.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef PacketTrace_h
+#define PacketTrace_h
+
+#include "Arduino.h"
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  PACKET_TRACE_SIZE    8             // number of packets retained in trace (kept small to conserve SRAM)
+#else                                         // Configuration for MEGA
+  #define  PACKET_TRACE_SIZE    32            // number of packets retained in trace
+#endif
+
+#define  PACKET_TRACE_BUDGET    1000          // microseconds expected to print one packet from trace (see Scheduler.h)
+
+struct PacketTraceRecord{
+  unsigned long time;                         // Clock::us() when packet was loaded
+  byte nReg;
+  byte nRepeat;
+  byte nBytes;                                // including checksum byte
+  byte b[6];
+}; // PacketTraceRecord
+
+struct PacketTrace{
+  static PacketTraceRecord trace[PACKET_TRACE_SIZE];
+  static byte head;
+  static byte count;
+  static byte nUnshown;                       // records added since the last <*> (SHOW_PACKETS 0 only)
+  static unsigned int nDropped;
+  static void add(int, byte *, int, int);
+  static void print(PacketTraceRecord *);
+  static void drain();
+  static void show();
+}; // PacketTrace
+
+#endif
@@ -0,0 +1,130 @@
+/**********************************************************************
+
+ParseCost.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION times every text command from the moment the parser receives it until the command, including
+any replies it prints, has been fully carried out, and retains the PARSE_COST_ENTRIES most expensive commands
+seen since start-up (or since last reset), together with the first PARSE_COST_TEXT characters of each.  This
+provides a worst-case parse-time budget for the command parser that can be tracked as the parser evolves, and
+that can be read back after feeding the Base Station malformed or adversarial input (e.g. with the -z option
+of tools/LoadGen.cpp).  At most one entry is kept for each command letter, so that commands which are expected
+to take a long time, such as reading a CV on the Programming Track, do not crowd out all of the others.
+
+To read or reset the most expensive commands use:
+
+  <y>:          returns each of the most expensive commands, most expensive first
+                returns: <y COST TEXT> for each retained command
+
+  <y 0>:        resets the list of most expensive commands
+                returns: <O>
+
+where
+
+  COST: the time taken by the command, in microseconds (roughly 16 instructions per microsecond at 16 MHz)
+  TEXT: the start of the command, without its < and > characters
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "ParseCost.h"
+#include "Clock.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// CALLED BEFORE COMMAND COM IS PARSED --- COPIES START OF COMMAND, SINCE PARSING MAY MODIFY IT
+
+void ParseCost::begin(char *com){
+  strncpy(text,com,PARSE_COST_TEXT);
+  startTime=Clock::us();
+} // ParseCost::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+// CALLED AFTER COMMAND HAS BEEN CARRIED OUT --- REPLACES ENTRY FOR SAME COMMAND LETTER, OR CHEAPEST ENTRY, IF MORE EXPENSIVE
+
+void ParseCost::end(){
+  unsigned long cost=Clock::us()-startTime;
+  ParseCostEntry *e, *w=worst;
+
+  for(e=worst;e<worst+PARSE_COST_ENTRIES;e++){
+    if(e->cost>0 && e->text[0]==text[0]){     // entry already exists for this command letter
+      w=e;
+      break;
+    }
+    if(e->cost<w->cost)
+      w=e;
+  }
+
+  if(cost<=w->cost)
+    return;
+
+  w->cost=cost;
+  memcpy(w->text,text,PARSE_COST_TEXT+1);
+} // ParseCost::end
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParseCost::show(){
+  int i, j, m, last=-1;
+
+  for(i=0;i<PARSE_COST_ENTRIES;i++){          // simple selection of next most expensive entry (ties in table order) --- list is very short
+    m=-1;
+    for(j=0;j<PARSE_COST_ENTRIES;j++){
+      if(worst[j].cost==0)
+        continue;
+      if(last>=0 && (worst[j].cost>worst[last].cost || (worst[j].cost==worst[last].cost && j<=last)))
+        continue;                             // already shown
+      if(m<0 || worst[j].cost>worst[m].cost)
+        m=j;
+    }
+    if(m<0)
+      break;
+    Messages::print(INTERFACE,PSTR("<y%L %s>"),worst[m].cost,worst[m].text);
+    last=m;
+  }
+} // ParseCost::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParseCost::reset(){
+  memset(worst,0,sizeof(worst));
+} // ParseCost::reset
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParseCost::parse(char *c){
+  int n;
+
+  switch(sscanf_P(c,PSTR("%d"),&n)){
+
+    case 1:                     // argument is zero --- reset
+      if(n==0){
+        reset();
+        INTERFACE.print(MSG(MSG_OK));
+      } else
+        INTERFACE.print(MSG(MSG_FAIL));
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+
+    default:                    // invalid argument
+      INTERFACE.print(MSG(MSG_FAIL));
+    break;
+  }
+} // ParseCost::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+ParseCostEntry ParseCost::worst[PARSE_COST_ENTRIES];
+char ParseCost::text[PARSE_COST_TEXT+1];
+unsigned long ParseCost::startTime;
@@ -0,0 +1,39 @@
+/**********************************************************************
+
+ParseCost.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef ParseCost_h
+#define ParseCost_h
+
+#include "Arduino.h"
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  PARSE_COST_ENTRIES   4             // number of most expensive commands retained (kept small to conserve SRAM)
+  #define  PARSE_COST_TEXT      12            // number of characters of each command retained
+#else                                         // Configuration for MEGA
+  #define  PARSE_COST_ENTRIES   8
+  #define  PARSE_COST_TEXT      24
+#endif
+
+struct ParseCostEntry{
+  unsigned long cost;                         // microseconds
+  char text[PARSE_COST_TEXT+1];
+}; // ParseCostEntry
+
+struct ParseCost{
+  static ParseCostEntry worst[PARSE_COST_ENTRIES];
+  static char text[PARSE_COST_TEXT+1];
+  static unsigned long startTime;
+  static void begin(char *);
+  static void end();
+  static void show();
+  static void reset();
+  static void parse(char *c);
+}; // ParseCost
+
+#endif
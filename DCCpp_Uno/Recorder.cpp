@@ -0,0 +1,355 @@
+/**********************************************************************
+
+Recorder.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION can RECORD the text and binary commands it receives from every session, and the sensor transitions it
+detects, into a compact time-stamped LOG, and later REPLAY that log, either with its original timing or as fast
+as possible.  This allows traffic captured at an operating session to be dumped, saved on a computer, loaded back
+into a Base Station on the bench, and replayed to reproduce or benchmark the load it placed on the command parser
+and scheduler.
+
+The log holds up to RECORDER_SIZE bytes, and is only allocated from SRAM once recording or loading starts.
+Each record takes the form
+
+  DT KIND DATA
+
+where DT is the number of milliseconds since the previous record (or since recording started), stored 7 bits per byte,
+least significant first, with the high bit set on every byte but the last; KIND is 0xFF for a sensor becoming active,
+0xFE for a sensor becoming inactive, 0xFD for a binary command, and otherwise the length of a text command; and DATA is
+the 2-byte ID of the sensor (low byte first), the LENGTH, OPCODE, and PAYLOAD of the binary frame (see BinaryCommand.cpp),
+or the text of the command without its < and > characters.  Records that do not fit once the log is full are counted
+as DROPPED.  Binary frames with a bad CRC, empty <> commands, <%> commands themselves, and <@> commands (which only
+concern the session that sent them, see Events.cpp) are not recorded.
+
+To record, replay, and transfer logs use:
+
+  <% 1>:             discards any existing log and starts recording
+                     returns: <O>, or <X> if there is not enough SRAM for the log
+
+  <% 2>:             replays the log with its original timing
+  <% 3>:             replays the log as fast as possible (one record each time the replay task is run)
+                     returns: <O>, or <X> if the log is empty or invalid, followed by <%E NRECORDS TIME> once the replay completes
+
+  <% 0>:             stops recording or replaying
+                     returns: <O>
+
+  <%>:               dumps the log
+                     returns: <% MODE NBYTES NRECORDS NDROPPED> followed by <%L OFFSET HEX> for every RECORDER_DUMP_BYTES bytes of the log
+
+  <%L OFFSET HEX>:   loads bytes into the log --- OFFSET 0 starts a new log, and every other OFFSET must continue where the previous one ended
+                     returns: <O>, or <X> if the log is full, OFFSET does not follow on, or recording or replay is in progress
+
+where
+
+  MODE: 0=idle, 1=recording, 2=replaying with original timing, 3=replaying as fast as possible
+  NBYTES: the number of bytes in the log
+  NRECORDS: the number of records in the log
+  NDROPPED: the number of records that did not fit in the log while recording
+  OFFSET: the position in the log of the first byte of HEX
+  HEX: a string of hexidecimal digits, two per byte
+  TIME: the number of milliseconds the replay took
+
+Since each line of a dump is itself a <%L> command, a log can be loaded back into a Base Station simply by sending
+it the <%L> lines of the dump in order.  During replay, each command is carried out just as if it had been received,
+and each sensor transition is reported (and triggers any stop reflexes and automation handlers) just as if it had been
+detected, whether or not the sensor is defined.  Replies generated during replay, including the binary replies
+to replayed binary commands, are sent to every session.
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Recorder.h"
+#include "SerialCommand.h"
+#include "BinaryCommand.h"
+#include "Sensor.h"
+#include "Clock.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RECORDS TEXT COMMAND COM (WITHOUT ITS < AND > CHARACTERS) IF RECORDING IS IN PROGRESS
+
+void Recorder::command(char *com){
+  if(mode!=RECORDER_RECORD || com[0]=='%' || com[0]=='@' || com[0]=='\0')
+    return;
+
+  add((byte)strlen(com),(byte *)com,strlen(com));
+} // Recorder::command
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RECORDS BINARY COMMAND OF LENGTH BYTES (OPCODE AND PAYLOAD) IN BUF IF RECORDING IS IN PROGRESS
+
+void Recorder::binary(byte *buf, byte length){
+  byte b[BINARY_MAX_LENGTH+1];
+
+  if(mode!=RECORDER_RECORD)
+    return;
+
+  b[0]=length;
+  memcpy(b+1,buf,length);
+  add(RECORDER_BINARY,b,length+1);
+} // Recorder::binary
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RECORDS TRANSITION OF SENSOR SNUM IF RECORDING IS IN PROGRESS
+
+void Recorder::sensor(int snum, boolean active){
+  byte b[2];
+
+  if(mode!=RECORDER_RECORD)
+    return;
+
+  b[0]=lowByte(snum);
+  b[1]=highByte(snum);
+  add(active?RECORDER_SENSOR_ON:RECORDER_SENSOR_OFF,b,2);
+} // Recorder::sensor
+
+///////////////////////////////////////////////////////////////////////////////
+
+boolean Recorder::add(byte kind, byte *data, int n){
+  byte head[6];
+  int nHead=0;
+  unsigned long t=Clock::ms();
+  unsigned long dt=t-lastTime;
+
+  do{                                     // encode DT 7 bits per byte
+    head[nHead++]=(dt&0x7F)|(dt>0x7F?0x80:0);
+    dt>>=7;
+  } while(dt>0);
+  head[nHead++]=kind;
+
+  if(nBytes+nHead+n>RECORDER_SIZE){
+    nDropped++;
+    return(false);
+  }
+
+  memcpy(log+nBytes,head,nHead);
+  memcpy(log+nBytes+nHead,data,n);
+  nBytes+=nHead+n;
+  nRecords++;
+  lastTime=t;
+  return(true);
+} // Recorder::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS THE POSITION OF THE RECORD FOLLOWING THE ONE AT POSITION P, OR -1 IF THE RECORD AT P IS INVALID
+
+int Recorder::walk(int p){
+  byte kind;
+
+  for(int i=0;p<nBytes && (log[p]&0x80);i++,p++)          // skip DT
+    if(i==4)
+      return(-1);
+
+  if(++p>=nBytes)
+    return(-1);
+
+  kind=log[p++];
+  if(kind>=RECORDER_SENSOR_OFF)
+    p+=2;
+  else if(kind==RECORDER_BINARY && p<nBytes && log[p]>0 && log[p]<=BINARY_MAX_LENGTH)
+    p+=1+log[p];
+  else if(kind>0 && kind<=MAX_COMMAND_LENGTH)
+    p+=kind;
+  else
+    return(-1);
+
+  return(p<=nBytes?p:-1);
+} // Recorder::walk
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Recorder::check(){
+  unsigned long dt=0;
+  int p, next;
+  byte kind;
+  char com[MAX_COMMAND_LENGTH+1];
+  BinaryCommand b;
+
+  if(mode<RECORDER_REPLAY)
+    return;
+
+  if(pos>=nBytes){
+    mode=RECORDER_IDLE;
+    Messages::print(INTERFACE,PSTR("<%%E %u %L>"),nRecords,Clock::ms()-replayStart);
+    return;
+  }
+
+  for(p=pos;log[p]&0x80;p++)                          // record was validated by walk() when replay started
+    dt|=(unsigned long)(log[p]&0x7F)<<(7*(p-pos));
+  dt|=(unsigned long)log[p]<<(7*(p-pos));
+  p++;
+
+  if(mode==RECORDER_REPLAY && Clock::ms()-replayStart<replayTime+dt)
+    return;                                           // not yet time for this record
+
+  replayTime+=dt;
+  next=walk(pos);
+  pos=next;
+
+  kind=log[p++];
+  if(kind>=RECORDER_SENSOR_OFF){
+    Sensor::report(word(log[p+1],log[p]),kind==RECORDER_SENSOR_ON);
+  } else if(kind==RECORDER_BINARY){
+    b.length=log[p];
+    memcpy(b.buf,log+p+1,b.length);
+    b.execute();
+  } else {
+    memcpy(com,log+p,kind);
+    com[kind]='\0';
+    SerialCommand::parse(com);
+  }
+} // Recorder::check
+
+///////////////////////////////////////////////////////////////////////////////
+
+boolean Recorder::allocate(){
+  if(log==NULL)
+    log=(byte *)malloc(RECORDER_SIZE);
+  return(log!=NULL);
+} // Recorder::allocate
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Recorder::start(int m){
+  int p;
+
+  switch(m){
+
+    case RECORDER_IDLE:
+      mode=RECORDER_IDLE;
+    break;
+
+    case RECORDER_RECORD:
+      if(!allocate()){
+        INTERFACE.print(MSG(MSG_FAIL));
+        return;
+      }
+      nBytes=0;
+      nRecords=0;
+      nDropped=0;
+      lastTime=Clock::ms();
+      mode=RECORDER_RECORD;
+    break;
+
+    case RECORDER_REPLAY:
+    case RECORDER_REPLAY_FAST:
+      nRecords=0;
+      for(p=0;p<nBytes && p>=0;p=walk(p))
+        nRecords++;
+      if(log==NULL || nBytes==0 || p<0){
+        mode=RECORDER_IDLE;
+        INTERFACE.print(MSG(MSG_FAIL));
+        return;
+      }
+      pos=0;
+      replayTime=0;
+      replayStart=Clock::ms();
+      mode=m;
+    break;
+
+    default:
+      INTERFACE.print(MSG(MSG_FAIL));
+      return;
+  }
+
+  INTERFACE.print(MSG(MSG_OK));
+} // Recorder::start
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Recorder::show(){
+  int p, n=0;
+
+  for(p=0;p<nBytes && p>=0;p=walk(p))
+    n++;
+
+  Messages::print(INTERFACE,PSTR("<%% %d %d %d %u>"),mode,nBytes,n,nDropped);
+
+  for(p=0;p<nBytes;p++){
+    if(p%RECORDER_DUMP_BYTES==0)
+      Messages::print(INTERFACE,PSTR("<%%L %d "),p);
+    if(log[p]<16)
+      INTERFACE.print('0');
+    INTERFACE.print(log[p],HEX);
+    if(p%RECORDER_DUMP_BYTES==RECORDER_DUMP_BYTES-1 || p==nBytes-1)
+      INTERFACE.print('>');
+  }
+} // Recorder::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Recorder::load(char *c){
+  int offset, n, p;
+  byte b;
+
+  if(mode!=RECORDER_IDLE || sscanf_P(c,PSTR("%d %n"),&offset,&n)!=1 || (offset!=0 && offset!=nBytes) || !allocate()){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  c+=n;
+  for(p=offset;isxdigit(c[0]) && isxdigit(c[1]);p++,c+=2){
+    if(p>=RECORDER_SIZE){
+      INTERFACE.print(MSG(MSG_FAIL));
+      return;
+    }
+    b=(isdigit(c[0])?c[0]-'0':(toupper(c[0])-'A'+10))<<4;
+    b|=isdigit(c[1])?c[1]-'0':(toupper(c[1])-'A'+10);
+    log[p]=b;
+    nBytes=p+1;                                  // log grows only as each byte is stored, so a failed load leaves a valid prefix
+  }
+
+  if(offset==0 && p==0)
+    nBytes=0;                                    // <%L 0> with no bytes empties the log
+
+  INTERFACE.print(MSG(MSG_OK));
+} // Recorder::load
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Recorder::parse(char *c){
+  int n;
+
+  if(c[0]=='L'){
+    load(c+1);
+    return;
+  }
+
+  switch(sscanf_P(c,PSTR("%d"),&n)){
+
+    case 1:                     // argument is the new mode
+      start(n);
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+
+    default:                    // invalid argument
+      INTERFACE.print(MSG(MSG_FAIL));
+    break;
+  }
+} // Recorder::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+byte *Recorder::log=NULL;
+int Recorder::nBytes=0;
+byte Recorder::mode=RECORDER_IDLE;
+unsigned int Recorder::nRecords=0;
+unsigned int Recorder::nDropped=0;
+unsigned long Recorder::lastTime;
+int Recorder::pos;
+unsigned long Recorder::replayStart;
+unsigned long Recorder::replayTime;
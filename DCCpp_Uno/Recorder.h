@@ -0,0 +1,56 @@
+/**********************************************************************
+
+Recorder.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Recorder_h
+#define Recorder_h
+
+#include "Arduino.h"
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  RECORDER_SIZE        128           // bytes of log (kept small to conserve SRAM --- only allocated once recording or loading starts)
+#else                                         // Configuration for MEGA
+  #define  RECORDER_SIZE        1024
+#endif
+
+#define  RECORDER_DUMP_BYTES    16            // bytes of log in each <%L> line of a dump
+#define  RECORDER_CHECK_BUDGET  500           // microseconds expected to replay one record (see Scheduler.h)
+
+#define  RECORDER_IDLE          0             // modes
+#define  RECORDER_RECORD        1
+#define  RECORDER_REPLAY        2             // replay with original timing
+#define  RECORDER_REPLAY_FAST   3             // replay as fast as possible
+
+#define  RECORDER_SENSOR_ON     0xFF          // record kinds --- any other kind is the length of a command
+#define  RECORDER_SENSOR_OFF    0xFE
+#define  RECORDER_BINARY        0xFD
+
+struct Recorder{
+  static byte *log;
+  static int nBytes;
+  static byte mode;
+  static unsigned int nRecords;
+  static unsigned int nDropped;
+  static unsigned long lastTime;
+  static int pos;
+  static unsigned long replayStart;
+  static unsigned long replayTime;
+  static void command(char *);
+  static void binary(byte *, byte);
+  static void sensor(int, boolean);
+  static boolean add(byte, byte *, int);
+  static void check();
+  static int walk(int);
+  static boolean allocate();
+  static void start(int);
+  static void show();
+  static void load(char *);
+  static void parse(char *c);
+}; // Recorder
+
+#endif
@@ -0,0 +1,273 @@
+/**********************************************************************
+
+Reflex.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION can stop a train the moment it triggers a sensor, without waiting for an interface to notice
+the <Q ID> return and send back a <t> command.  Each such STOP REFLEX binds a sensor to a throttle register and cab,
+and is carried out from within the sensor scan, immediately upon the sensor becoming active and before the <Q ID>
+return is even sent.
+
+To define stop reflexes, use the following variations of the "V" command:
+
+  <V ID REGISTER CAB ACTION [SPEED]>:  creates a stop reflex for sensor ID, replacing any existing reflex for that sensor
+                                       returns: <O> if successful and <X> if unsuccessful (e.g. out of memory or invalid REGISTER, CAB, or ACTION)
+
+  <V ID>:                              deletes the stop reflex for sensor ID
+                                       returns: <O> if successful and <X> if unsuccessful (e.g. reflex does not exist)
+
+  <V>:                                 lists all defined stop reflexes, followed by reflex latency statistics
+                                       returns: <V ID REGISTER CAB ACTION SPEED> for each defined reflex, followed by
+                                       <v NFIRED LAST MAX>
+
+where
+
+  ID: the numeric ID (0-32767) of the sensor
+  REGISTER: the throttle register (1 through MAX_MAIN_REGISTERS) in use by the engine to stop
+  CAB: the short (1-127) or long (128-10293) address of the engine decoder
+  ACTION: 0 = stop (set speed to 0)
+          1 = emergency stop
+          2 = reduce speed to SPEED (0-126), if currently faster
+  SPEED: the reduced speed for ACTION 2 (ignored, and returned as 0, for other actions)
+  NFIRED: the number of times any stop reflex has been carried out
+  LAST: the LATENCY of the most recent stop reflex, in microseconds
+  MAX: the longest LATENCY of any stop reflex, in microseconds
+
+The direction of the engine is left unchanged.  A reflex whose REGISTER is already stopped is skipped (and not counted
+in NFIRED), since the direction of a stopped engine is not known.  LATENCY is the time from the sensor scan detecting
+that the sensor has become active until the DCC signal interrupt begins transmitting the resulting throttle packet on
+the Main Track, including any wait for a packet loaded before it, but not for packets loaded after it.  The interrupt
+time-stamps the moment it picks up the packet, so LATENCY does not include any delay before the REFLEX task notices
+(unless another packet has been picked up in the meantime, in which case the time it was noticed is used instead).
+The distribution of LATENCY is also recorded in the REFLEX histogram (see Histogram.cpp).
+
+Once all stop reflexes have been properly defined, use the <E> command to store their definitions to EEPROM.
+You can also clear everything stored in the EEPROM by invoking the <e> command.
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Reflex.h"
+#include "SerialCommand.h"
+#include "EEStore.h"
+#include "Clock.h"
+#include "Histogram.h"
+#include "Messages.h"
+#include <EEPROM.h>
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// CARRIES OUT THE STOP REFLEX, IF ANY, FOR SENSOR SNUM, WHICH HAS JUST BECOME ACTIVE
+
+void Reflex::fire(int snum){
+  Reflex *tt;
+  unsigned long t;
+  int tSpeed, tDirection;
+
+  if(firstReflex==NULL || (tt=get(snum))==NULL)
+    return;
+
+  t=Clock::us();
+
+  tSpeed=SerialCommand::mRegs->speedTable[tt->data.nReg];
+  if(tSpeed==0)                 // already stopped --- the direction is no longer known, and re-sending it could reverse the engine (and its headlights)
+    return;
+  tDirection=(tSpeed>0);
+  tSpeed=abs(tSpeed);
+
+  if(tt->data.action==REFLEX_ESTOP)
+    tSpeed=-1;
+  else if(tt->data.action==REFLEX_SLOW)
+    tSpeed=min(tSpeed,(int)tt->data.speed);
+  else
+    tSpeed=0;
+
+  if(SerialCommand::mRegs->setThrottle(tt->data.nReg,tt->data.cab,tSpeed,tDirection)!=0)
+    return;
+
+  pendingReg=SerialCommand::mRegs->regMap[tt->data.nReg];      // throttle packet now waits in updatePacket of its Register until picked up
+  pendingPacket=pendingReg->updatePacket;
+  nFired++;
+  pendingTime=t;
+  pending=true;                 // check() will complete latency measurement once packet has been picked up by interrupt
+} // Reflex::fire
+
+///////////////////////////////////////////////////////////////////////////////
+
+// THE REFLEX PACKET HAS BEEN PICKED UP ONCE ITS REGISTER IS NO LONGER WAITING AS nextReg, OR ITS PACKET HAS BECOME THE ACTIVE ONE
+// (IN CASE THE SAME REGISTER HAS SINCE BEEN RE-LOADED) --- PACKETS LOADED INTO OTHER REGISTERS AFTER THE REFLEX DO NOT DELAY THE MEASUREMENT.
+// LATENCY ENDS AT THE TIME THE DCC SIGNAL INTERRUPT STAMPED ON THE PICK-UP, NOT WHEN THIS TASK NEXT RUNS
+
+void Reflex::check(){
+  unsigned long t;
+
+  if(!pending || (SerialCommand::mRegs->nextReg==pendingReg && pendingReg->activePacket!=pendingPacket))   // reflex packet still waiting to be picked up by DCC signal interrupt
+    return;
+
+  pending=false;
+  noInterrupts();                                             // pick-up time is stamped by DCC signal interrupt
+  if(SerialCommand::mRegs->pickupReg==pendingReg)
+    t=SerialCommand::mRegs->pickupTime;
+  else                                                        // another Register has since been picked up --- time of pick-up is lost, so use the time it was noticed
+    t=Clock::us();
+  interrupts();
+  t-=pendingTime;
+  lastLatency=min(t,65535UL);
+  if(lastLatency>maxLatency)
+    maxLatency=lastLatency;
+  Histogram::reflexTime.add(t);
+} // Reflex::check
+
+///////////////////////////////////////////////////////////////////////////////
+
+Reflex *Reflex::create(int snum, int nReg, int cab, int action, int speed, int v){
+  Reflex *tt;
+
+  if(nReg<1 || nReg>MAX_MAIN_REGISTERS || cab<0 || cab>10293 || action<REFLEX_STOP || action>REFLEX_SLOW){     // same ranges as setThrottle(), which would otherwise reject every firing
+    if(v==1)
+      INTERFACE.print(MSG(MSG_FAIL));
+    return(NULL);
+  }
+
+  if(firstReflex==NULL){
+    firstReflex=(Reflex *)calloc(1,sizeof(Reflex));
+    tt=firstReflex;
+  } else if((tt=get(snum))==NULL){
+    tt=firstReflex;
+    while(tt->nextReflex!=NULL)
+      tt=tt->nextReflex;
+    tt->nextReflex=(Reflex *)calloc(1,sizeof(Reflex));
+    tt=tt->nextReflex;
+  }
+
+  if(tt==NULL){       // problem allocating memory
+    if(v==1)
+      INTERFACE.print(MSG(MSG_FAIL));
+    return(tt);
+  }
+
+  tt->data.snum=snum;
+  tt->data.nReg=nReg;
+  tt->data.cab=cab;
+  tt->data.action=action;
+  tt->data.speed=(action==REFLEX_SLOW)?constrain(speed,0,126):0;
+
+  if(v==1)
+    INTERFACE.print(MSG(MSG_OK));
+  return(tt);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Reflex* Reflex::get(int n){
+  Reflex *tt;
+  for(tt=firstReflex;tt!=NULL && tt->data.snum!=n;tt=tt->nextReflex);
+  return(tt);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Reflex::remove(int n){
+  Reflex *tt,*pp=NULL;
+
+  for(tt=firstReflex;tt!=NULL && tt->data.snum!=n;pp=tt,tt=tt->nextReflex);
+
+  if(tt==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  if(tt==firstReflex)
+    firstReflex=tt->nextReflex;
+  else
+    pp->nextReflex=tt->nextReflex;
+
+  free(tt);
+
+  INTERFACE.print(MSG(MSG_OK));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Reflex::show(){
+  Reflex *tt;
+
+  for(tt=firstReflex;tt!=NULL;tt=tt->nextReflex)
+    Messages::print(INTERFACE,PSTR("<V%d %d %d %d %d>"),tt->data.snum,tt->data.nReg,tt->data.cab,tt->data.action,tt->data.speed);
+
+  Messages::print(INTERFACE,PSTR("<v%u %u %u>"),nFired,lastLatency,maxLatency);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Reflex::parse(char *c){
+  int n,r,m,a,s;
+
+  switch(sscanf_P(c,PSTR("%d %d %d %d %d"),&n,&r,&m,&a,&s)){
+
+    case 4:                     // argument is string with id number of sensor followed by register, cab, and action
+      s=0;
+      // fall through
+
+    case 5:                     // argument is string with id number of sensor followed by register, cab, action, and speed
+      create(n,r,m,a,s,1);
+    break;
+
+    case 1:                     // argument is a string with id number only
+      remove(n);
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+
+    default:                    // invalid number of arguments
+      INTERFACE.print(MSG(MSG_FAIL));
+    break;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Reflex::load(){
+  struct ReflexData data;
+
+  for(int i=0;i<EEStore::eeStore->data.nReflexes;i++){
+    EEPROM.get(EEStore::pointer(),data);
+    create(data.snum,data.nReg,data.cab,data.action,data.speed);
+    EEStore::advance(sizeof(data));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Reflex::store(){
+  Reflex *tt;
+
+  tt=firstReflex;
+  EEStore::eeStore->data.nReflexes=0;
+
+  while(tt!=NULL){
+    EEPROM.put(EEStore::pointer(),tt->data);
+    EEStore::advance(sizeof(tt->data));
+    tt=tt->nextReflex;
+    EEStore::eeStore->data.nReflexes++;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Reflex *Reflex::firstReflex=NULL;
+boolean Reflex::pending=false;
+unsigned long Reflex::pendingTime;
+Register *Reflex::pendingReg;
+Packet *Reflex::pendingPacket;
+unsigned int Reflex::nFired=0;
+unsigned int Reflex::lastLatency=0;
+unsigned int Reflex::maxLatency=0;
@@ -0,0 +1,52 @@
+/**********************************************************************
+
+Reflex.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Reflex_h
+#define Reflex_h
+
+#include "Arduino.h"
+#include "PacketRegister.h"
+
+#define  REFLEX_STOP          0
+#define  REFLEX_ESTOP         1
+#define  REFLEX_SLOW          2
+
+#define  REFLEX_CHECK_BUDGET  50        // microseconds expected to check whether a reflex packet has been picked up (see Scheduler.h)
+
+struct ReflexData {
+  int snum;
+  byte nReg;
+  byte action;
+  int cab;
+  byte speed;
+};
+
+struct Reflex{
+  static Reflex *firstReflex;
+  static boolean pending;
+  static unsigned long pendingTime;
+  static Register *pendingReg;                  // Register, and Packet within it, holding the reflex throttle packet awaiting pick-up
+  static Packet *pendingPacket;
+  static unsigned int nFired;
+  static unsigned int lastLatency;
+  static unsigned int maxLatency;
+  struct ReflexData data;
+  Reflex *nextReflex;
+  static void fire(int);
+  static void check();
+  static void parse(char *c);
+  static Reflex* get(int);
+  static void remove(int);
+  static void load();
+  static void store();
+  static Reflex *create(int, int, int, int, int, int=0);
+  static void show();
+}; // Reflex
+
+#endif
@@ -0,0 +1,171 @@
+/**********************************************************************
+
+Roster.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION keeps a small roster of CV values that have been read from decoders on the
+Programming Track so that repeated reads of the same decoder can be answered without the
+lengthy bit-by-bit verification process.  Each roster entry is keyed by the manufacturer (CV8),
+version (CV7) and active address (CV1, or CV17/CV18 if CV29 selects long addressing) of the decoder.
+
+The roster is only used by the batch read command:
+
+  <J CALLBACKNUM CALLBACKSUB [CV1 CV2 ... CV8]>
+
+which always identifies the decoder currently on the Programming Track first, and then reads each requested CV
+from the decoder.  A cached value is never returned without being verified, since two decoders of the same make
+may share an address (e.g. two locomotives still at the factory default address 3), but the value cached in the
+roster entry of that decoder, followed by the values cached for other decoders of the same manufacturer and version,
+are first tried as candidates with a single byte-verify each, before falling back to a full bit-by-bit read.
+See RegisterList::readCVBatch() and RegisterList::readCVValue() for details.
+
+The roster is held only in SRAM and is lost on power-down.  Writing a CV with the <W> or <B> commands on the
+Programming Track, or the <w> or <b> commands on the Main Operations Track, removes that CV from every roster entry,
+since it is not known which decoder was written.  When the roster is full, the least-recently used entry is replaced.
+
+**********************************************************************/
+
+#include "Roster.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+int Roster::get(int cv){
+
+  switch(cv){                                   // identifying CVs are always known
+    case 8:
+      return(mfr);
+    case 7:
+      return(version);
+    case 29:
+      return(cv29);
+    case 1:
+      return(bitRead(cv29,5)?-1:address);
+    case 17:
+      return(bitRead(cv29,5)?highByte(address)|0xC0:-1);
+    case 18:
+      return(bitRead(cv29,5)?lowByte(address):-1);
+  }
+
+  for(int i=0;i<nCVs;i++){
+    if(cvs[i].cv==cv)
+      return(cvs[i].value);
+  }
+  return(-1);
+} // Roster::get
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Roster::put(int cv, byte value){
+  int i;
+
+  for(i=0;i<nCVs && cvs[i].cv!=cv;i++);
+
+  if(i==nCVs){                                  // CV is not yet cached
+    if(nCVs<ROSTER_MAX_CVS){
+      nCVs++;
+    } else{                                     // no room --- replace CVs in round-robin fashion
+      i=nextCV;
+      nextCV=(nextCV+1)%ROSTER_MAX_CVS;
+    }
+  }
+
+  cvs[i].cv=cv;
+  cvs[i].value=value;
+} // Roster::put
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS ROSTER ENTRY MATCHING MANUFACTURER, VERSION, AND ADDRESS
+// IF NO SUCH ENTRY EXISTS, THE LEAST-RECENTLY USED ENTRY IS CLEARED AND RE-USED FOR THIS DECODER
+
+Roster *Roster::add(int mfr, int version, int address, int cv29){
+  Roster *r, *lru;
+
+  lru=roster;
+
+  for(r=roster;r<roster+ROSTER_SIZE;r++){
+    if(r->lastUsed!=0 && r->mfr==mfr && r->version==version && r->address==address)
+      break;
+    if((unsigned int)(useCount-r->lastUsed)>(unsigned int)(useCount-lru->lastUsed))
+      lru=r;
+  }
+
+  if(r==roster+ROSTER_SIZE){                    // decoder not found in roster
+    r=lru;
+    r->mfr=mfr;
+    r->version=version;
+    r->address=address;
+    r->cv29=cv29;
+    r->nCVs=0;
+    r->nextCV=0;
+  }
+
+  if(++useCount==0)                             // zero is reserved to mark unused entries
+    useCount++;
+  r->lastUsed=useCount;
+  return(r);
+} // Roster::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+// APPENDS CACHED VALUES OF CV TO THE LIST OF CANDIDATE VALUES H (WHICH ALREADY CONTAINS N VALUES), MOST-RECENTLY USED DECODERS FIRST,
+// STOPPING ONCE ROSTER_MAX_HINTS CANDIDATES ARE IN THE LIST.  ONLY DECODERS MATCHING MFR AND VERSION ARE CONSIDERED, UNLESS THESE ARE -1
+// RETURNS THE NEW NUMBER OF VALUES IN H
+
+int Roster::hints(int cv, int mfr, int version, int *h, int n){
+  Roster *r, *best;
+  unsigned int age, bestAge=0, prevAge=0;
+  boolean first=true;
+  int v, i;
+
+  while(n<ROSTER_MAX_HINTS){
+    best=NULL;
+    for(r=roster;r<roster+ROSTER_SIZE;r++){               // find next most-recently used entry
+      age=useCount-r->lastUsed;
+      if(r->lastUsed==0 || (!first && age<=prevAge))
+        continue;
+      if(best==NULL || age<bestAge){
+        best=r;
+        bestAge=age;
+      }
+    }
+    if(best==NULL)
+      break;
+    prevAge=bestAge;
+    first=false;
+    if((mfr>=0 && best->mfr!=mfr) || (version>=0 && best->version!=version) || (v=best->get(cv))<0)
+      continue;
+    for(i=0;i<n && h[i]!=v;i++);
+    if(i==n)                                              // skip duplicates
+      h[n++]=v;
+  }
+
+  return(n);
+} // Roster::hints
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Roster::invalidate(int cv){
+  Roster *r;
+  int i;
+
+  for(r=roster;r<roster+ROSTER_SIZE;r++){
+    if(cv==1 || cv==7 || cv==8 || cv==17 || cv==18 || cv==29){     // identifying CV changed --- decoder could now match any entry, so discard them all
+      r->lastUsed=0;
+      continue;
+    }
+    for(i=0;i<r->nCVs && r->cvs[i].cv!=cv;i++);
+    if(i<r->nCVs)
+      r->cvs[i]=r->cvs[--r->nCVs];              // move last CV into the vacated slot
+  }
+} // Roster::invalidate
+
+///////////////////////////////////////////////////////////////////////////////
+
+Roster Roster::roster[ROSTER_SIZE];
+unsigned int Roster::useCount=0;
@@ -0,0 +1,50 @@
+/**********************************************************************
+
+Roster.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Roster_h
+#define Roster_h
+
+#include "Arduino.h"
+
+// Define constants used for caching CVs read from decoders on the Programming Track
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  ROSTER_SIZE             4          // number of different decoders whose CVs are cached
+#else                                         // Configuration for MEGA
+  #define  ROSTER_SIZE            16
+#endif
+
+#define  ROSTER_MAX_CVS            8          // number of CVs cached for each decoder (in addition to the identifying manufacturer, version, and address)
+#define  ROSTER_MAX_BATCH          8          // maximum number of CVs that can be requested in a single batch read
+#define  ROSTER_MAX_HINTS          4          // maximum number of candidate values to try with a byte-verify before reading a CV bit by bit
+
+struct RosterCV{
+  int cv;
+  byte value;
+}; // RosterCV
+
+struct Roster{
+  byte mfr;
+  byte version;
+  byte cv29;
+  int address;
+  byte nCVs;
+  byte nextCV;
+  unsigned int lastUsed;
+  RosterCV cvs[ROSTER_MAX_CVS];
+  static Roster roster[ROSTER_SIZE];
+  static unsigned int useCount;
+  int get(int);
+  void put(int, byte);
+  static Roster *add(int, int, int, int);
+  static int hints(int, int, int, int *, int);
+  static void invalidate(int);
+}; // Roster
+
+#endif
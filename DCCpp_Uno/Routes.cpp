@@ -0,0 +1,359 @@
+/**********************************************************************
+
+Routes.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION can group any number of previously-defined turnouts and outputs into a ROUTE
+that is set with a single command.  This is useful for yard ladders and other multi-turnout paths that would
+otherwise require the interface to send a separate <T ID THROW> command for each turnout.
+
+To define routes, use the following variations of the "U" command:
+
+  <U ID TYPE OBJID STATE>:     adds an entry to route ID, creating the route if it does not already exist
+                               if route ID already contains an entry for the same TYPE and OBJID, its STATE is updated
+                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory)
+
+  <U ID>:                      deletes definition of route ID
+                               returns: <O> if successful and <X> if unsuccessful (e.g. ID does not exist)
+
+  <U>:                         lists all defined routes
+                               returns: <U ID TYPE OBJID STATE> for each entry in each defined route or <X> if no routes defined
+
+where
+
+  ID: the numeric ID (0-32767) of the route
+  TYPE: 0 = the entry refers to a turnout defined with the <T> command
+        1 = the entry refers to an output defined with the <Z> command
+  OBJID: the numeric ID (0-32767) of the turnout or output
+  STATE: the position to set the turnout (0=unthrown, 1=thrown) or output (0=inactive, 1=active) to when the route is fired
+
+Once all routes have been properly defined, use the <E> command to store their definitions to EEPROM.
+If you later make edits/additions/deletions to the route definitions, you must invoke the <E> command if you want those
+new definitions updated in the EEPROM.  You can also clear everything stored in the EEPROM by invoking the <e> command.
+
+To fire routes that have been defined use:
+
+  <U ID ACTION>:               fires (ACTION=1) route ID, or cancels (ACTION=0) a firing of route ID that is still in progress
+                               returns: <u ID NSET NMISSING> once all entries have been set (or the firing was cancelled),
+                               or <X> if route ID does not exist
+
+where
+
+  NSET: the number of turnouts and outputs that were set
+  NMISSING: the number of entries that were skipped because the referenced turnout or output is no longer defined
+
+Firing a route does not block the sketch.  Entries are set in order from within the main loop, with turnouts
+activated no faster than one every ROUTE_PACE_TIME milliseconds (see Config.h) so that solenoid power supplies
+and capacitive discharge units have time to recover between throws.  Outputs do not draw on solenoid power and are
+set without pausing.  Throttle and other commands continue to be processed while a route is being fired, and several
+routes may be fired at once, in which case their turnouts are interleaved.
+
+Turnouts and outputs set by a route individually update their stored state in EEPROM exactly as if they had been set
+with the <T> or <Z> commands, but do not generate individual <H ID THROW> or <Y ID STATE> returns.  Only the single
+<u ID NSET NMISSING> summary is returned for the entire route.
+
+**********************************************************************/
+
+#include "Routes.h"
+#include "Accessories.h"
+#include "Outputs.h"
+#include "SerialCommand.h"
+#include "DCCpp_Uno.h"
+#include "EEStore.h"
+#include "Clock.h"
+#include <EEPROM.h>
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::fire(){
+  nFired=0;
+  nMissing=0;
+  active=true;
+  if(nextFire==NULL)
+    nextFire=this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::cancel(){
+  if(!active)
+    return;
+  active=false;
+  report();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::report(){
+  INTERFACE.print(F("<u"));
+  INTERFACE.print(data.id);
+  INTERFACE.print(' ');
+  INTERFACE.print(nFired-nMissing);
+  INTERFACE.print(' ');
+  INTERFACE.print(nMissing);
+  INTERFACE.print('>');
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::check(){
+  Route *rr;
+  RouteEntry *e;
+  Turnout *t;
+  Output *o;
+
+  if(nextFire!=NULL && !nextFire->active){              // route was cancelled or removed --- look for any other route still being fired
+    for(rr=firstRoute;rr!=NULL && !rr->active;rr=rr->nextRoute);
+    nextFire=rr;
+  }
+
+  if(nextFire==NULL)                                    // no routes are being fired
+    return;
+
+  if(Clock::ms()-paceTime<ROUTE_PACE_TIME)                 // give solenoid power time to recover since last turnout was thrown
+    return;
+
+  if(SerialCommand::mRegs->nextReg!=NULL)               // Main Track is still waiting to pick up a prior packet --- try again on next loop rather than blocking in loadPacket()
+    return;
+
+  rr=nextFire;
+
+  while(rr->nFired<rr->data.nEntries){
+    e=rr->entry+rr->nFired++;
+    if(e->type==ROUTE_OUTPUT){                          // outputs are set immediately since they do not draw on solenoid power
+      if((o=Output::get(e->id))==NULL)
+        rr->nMissing++;
+      else
+        o->activate(e->state,0);
+    } else if((t=Turnout::get(e->id))==NULL){
+      rr->nMissing++;
+    } else{
+      t->activate(e->state,0);
+      paceTime=Clock::ms();
+      break;                                            // only one turnout per pace interval
+    }
+  }
+
+  if(rr->nFired>=rr->data.nEntries){
+    rr->active=false;
+    rr->report();
+  }
+
+  do{                                                   // interleave any other routes being fired by moving on to the next active route (wrapping around to rr itself)
+    nextFire=(nextFire->nextRoute==NULL)?firstRoute:nextFire->nextRoute;
+  } while(!nextFire->active && nextFire!=rr);
+
+  if(!nextFire->active)
+    nextFire=NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Route* Route::get(int n){
+  Route *tt;
+  for(tt=firstRoute;tt!=NULL && tt->data.id!=n;tt=tt->nextRoute);
+  return(tt);
+}
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::remove(int n){
+  Route *tt,*pp=NULL;
+
+  for(tt=firstRoute;tt!=NULL && tt->data.id!=n;pp=tt,tt=tt->nextRoute);
+
+  if(tt==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  tt->cancel();
+
+  if(tt==firstRoute)
+    firstRoute=tt->nextRoute;
+  else
+    pp->nextRoute=tt->nextRoute;
+
+  if(nextFire==tt)
+    nextFire=firstRoute;                                // check() will move on to the next active route, if any
+
+  free(tt->entry);
+  free(tt);
+
+  INTERFACE.print(MSG(MSG_OK));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::show(){
+  Route *tt;
+
+  if(firstRoute==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  for(tt=firstRoute;tt!=NULL;tt=tt->nextRoute){
+    if(tt->data.nEntries==0){
+      INTERFACE.print(F("<U"));
+      INTERFACE.print(tt->data.id);
+      INTERFACE.print('>');
+    }
+    for(int i=0;i<tt->data.nEntries;i++){
+      INTERFACE.print(F("<U"));
+      INTERFACE.print(tt->data.id);
+      INTERFACE.print(' ');
+      INTERFACE.print(tt->entry[i].type);
+      INTERFACE.print(' ');
+      INTERFACE.print(tt->entry[i].id);
+      INTERFACE.print(' ');
+      INTERFACE.print(tt->entry[i].state);
+      INTERFACE.print('>');
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::parse(char *c){
+  int n,s,m,t;
+  Route *r;
+
+  switch(sscanf_P(c,PSTR("%d %d %d %d"),&n,&t,&m,&s)){
+
+    case 4:                     // argument is string with id number of route followed by an entry type, turnout or output id, and state
+      add(n,t,m,s);
+    break;
+
+    case 2:                     // argument is string with id number of route followed by one (fire) or zero (cancel)
+      r=get(n);
+      if(r==NULL)
+        INTERFACE.print(MSG(MSG_FAIL));
+      else if(t>0)
+        r->fire();
+      else
+        r->cancel();
+    break;
+
+    case 1:                     // argument is a string with id number only
+      remove(n);
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+
+    case 3:                     // invalid number of arguments
+      INTERFACE.print(MSG(MSG_FAIL));
+    break;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::add(int id, int type, int objId, int state){
+  Route *tt;
+  RouteEntry *e;
+  int i;
+
+  if((tt=get(id))==NULL && (tt=create(id))==NULL){
+    INTERFACE.print(MSG(MSG_FAIL));
+    return;
+  }
+
+  for(i=0;i<tt->data.nEntries && !(tt->entry[i].type==(type>0) && tt->entry[i].id==objId);i++);
+
+  if(i==tt->data.nEntries){                             // this is a new entry
+    if(tt->data.nEntries==255 || tt->active || (e=(RouteEntry *)realloc(tt->entry,(i+1)*sizeof(RouteEntry)))==NULL){
+      INTERFACE.print(MSG(MSG_FAIL));
+      return;
+    }
+    tt->entry=e;
+    tt->entry[i].type=(type>0);
+    tt->entry[i].id=objId;
+    tt->data.nEntries++;
+  }
+
+  tt->entry[i].state=(state>0);
+  INTERFACE.print(MSG(MSG_OK));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::load(){
+  struct RouteData data;
+  Route *tt;
+
+  for(int i=0;i<EEStore::eeStore->data.nRoutes;i++){
+    EEPROM.get(EEStore::pointer(),data);
+    EEStore::advance(sizeof(data));
+    tt=create(data.id);
+    tt->entry=(RouteEntry *)calloc(data.nEntries,sizeof(RouteEntry));
+    for(int j=0;j<data.nEntries;j++){
+      EEPROM.get(EEStore::pointer(),tt->entry[j]);
+      EEStore::advance(sizeof(RouteEntry));
+    }
+    tt->data.nEntries=data.nEntries;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Route::store(){
+  Route *tt;
+
+  tt=firstRoute;
+  EEStore::eeStore->data.nRoutes=0;
+
+  while(tt!=NULL){
+    EEPROM.put(EEStore::pointer(),tt->data);
+    EEStore::advance(sizeof(tt->data));
+    for(int j=0;j<tt->data.nEntries;j++){
+      EEPROM.put(EEStore::pointer(),tt->entry[j]);
+      EEStore::advance(sizeof(RouteEntry));
+    }
+    tt=tt->nextRoute;
+    EEStore::eeStore->data.nRoutes++;
+  }
+
+}
+///////////////////////////////////////////////////////////////////////////////
+
+Route *Route::create(int id, int v){
+  Route *tt;
+
+  if(firstRoute==NULL){
+    firstRoute=(Route *)calloc(1,sizeof(Route));
+    tt=firstRoute;
+  } else if((tt=get(id))==NULL){
+    tt=firstRoute;
+    while(tt->nextRoute!=NULL)
+      tt=tt->nextRoute;
+    tt->nextRoute=(Route *)calloc(1,sizeof(Route));
+    tt=tt->nextRoute;
+  }
+
+  if(tt==NULL){       // problem allocating memory
+    if(v==1)
+      INTERFACE.print(MSG(MSG_FAIL));
+    return(tt);
+  }
+
+  tt->data.id=id;
+  if(v==1)
+    INTERFACE.print(MSG(MSG_OK));
+  return(tt);
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Route *Route::firstRoute=NULL;
+Route *Route::nextFire=NULL;
+unsigned long Route::paceTime=0;
@@ -0,0 +1,56 @@
+/**********************************************************************
+
+Routes.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#include "Arduino.h"
+#include "Config.h"
+
+#ifndef Routes_h
+#define Routes_h
+
+#define  ROUTE_TURNOUT   0
+#define  ROUTE_OUTPUT    1
+
+#define  ROUTE_CHECK_BUDGET   500       // microseconds expected to set the next route entry (see Scheduler.h)
+
+struct RouteEntry {
+  byte type;
+  byte state;
+  int id;
+};
+
+struct RouteData {
+  int id;
+  byte nEntries;
+};
+
+struct Route{
+  static Route *firstRoute;
+  static Route *nextFire;
+  static unsigned long paceTime;
+  struct RouteData data;
+  RouteEntry *entry;
+  byte nFired;
+  byte nMissing;
+  boolean active;
+  Route *nextRoute;
+  void fire();
+  void cancel();
+  void report();
+  static void parse(char *c);
+  static Route* get(int);
+  static void remove(int);
+  static void load();
+  static void store();
+  static Route *create(int, int=0);
+  static void add(int, int, int, int);
+  static void show();
+  static void check();
+}; // Route
+
+#endif
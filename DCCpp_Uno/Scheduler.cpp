@@ -0,0 +1,209 @@
+/**********************************************************************
+
+Scheduler.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION runs each of its subsystems (reading commands, monitoring current, checking sensors,
+firing routes) as a TASK within a simple cooperative scheduler called from the main loop.
+
+Each task is registered with a PERIOD, the number of microseconds between runs, and a BUDGET, the number of
+microseconds each run is expected to take.  On every pass through the main loop, all tasks that are due are run,
+critical tasks first and otherwise in order of how long they are overdue, so that a task kept waiting by another is
+run as soon as possible.
+
+Some operations, such as reading and writing Configuration Variables on the Programming Track, or waiting for
+the Main Track to pick up a new packet, can take far longer than any budget.  These operations call
+Scheduler::yield() while they wait, which runs only tasks flagged as CRITICAL.  This ensures that current
+monitoring, and hence short-circuit protection, keeps its sampling rate regardless of what commands are being processed.
+Anything a critical task prints while another command waits is sent to every session, just as when it runs from the main loop.
+
+To observe how well tasks are meeting their schedules use:
+
+  <K>:          lists the scheduling statistics of each task
+                returns: <K NAME PERIOD BUDGET MAXLATENCY MAXRUN NOVERRUNS> for each task
+
+  <K 0>:        resets MAXLATENCY, MAXRUN and NOVERRUNS of all tasks
+                returns: <O>
+
+where
+
+  NAME: the name of the task
+  PERIOD: microseconds between scheduled runs of the task (0=every pass through the main loop)
+  BUDGET: microseconds each run of the task is expected to take
+  MAXLATENCY: the longest time, in microseconds, the task was kept waiting past its scheduled time (for tasks with
+              PERIOD=0, the longest time between successive runs)
+  MAXRUN: the longest time, in microseconds, a single run of the task took
+  NOVERRUNS: the number of runs that took longer than BUDGET
+
+**********************************************************************/
+
+#include "DCCpp_Uno.h"
+#include "Scheduler.h"
+#include "Clock.h"
+#include "Messages.h"
+#include "Comm.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::add(const char *name, void (*run)(), unsigned int period, unsigned int budget, byte flags){
+  Task *t;
+
+  if(nTasks==SCHEDULER_MAX_TASKS)
+    return;
+
+  t=task+nTasks++;
+  t->name=name;
+  t->run=run;
+  t->period=period;
+  t->budget=budget;
+  t->flags=flags;
+  t->lastRun=Clock::us();
+  t->maxLatency=0;
+  t->maxRun=0;
+  t->nOverruns=0;
+#if SCHEDULER_HISTOGRAMS
+  t->runTime.reset();
+#endif
+} // Scheduler::add
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::runTask(Task *t, unsigned long late){
+  unsigned long start=Clock::us();
+
+  if(late>t->maxLatency)
+    t->maxLatency=late;
+
+  t->lastRun=start;
+  t->run();
+
+  start=Clock::us()-start;
+#if SCHEDULER_HISTOGRAMS
+  t->runTime.add(start);
+#endif
+  if(start>t->maxRun)
+    t->maxRun=start;
+  if(start>t->budget)
+    t->nOverruns++;
+} // Scheduler::runTask
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::run(){
+  Task *t;
+  unsigned long elapsed, late, mostLate;
+  byte done=0;
+  int next;
+
+  for(byte n=0;n<nTasks;n++){                         // each task runs at most once per pass
+    next=-1;
+    mostLate=0;
+    for(byte i=0;i<nTasks;i++){                       // find the task that is most overdue
+      t=task+i;
+      if(bitRead(done,i))
+        continue;
+      elapsed=Clock::us()-t->lastRun;
+      if(elapsed<t->period)
+        continue;
+      late=elapsed-t->period;
+      if(next<0 || (t->flags&TASK_CRITICAL)>(task[next].flags&TASK_CRITICAL) || ((t->flags&TASK_CRITICAL)==(task[next].flags&TASK_CRITICAL) && late>mostLate)){
+        next=i;
+        mostLate=late;
+      }
+    }
+    if(next<0)                                        // no more tasks are due
+      return;
+    bitSet(done,next);
+    runTask(task+next,mostLate);
+  }
+} // Scheduler::run
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::yield(){
+  Task *t;
+  unsigned long elapsed;
+  Session *s=Session::current;
+
+  if(yielding)                                        // a critical task is itself waiting
+    return;
+
+  yielding=true;
+  Session::current=NULL;                              // anything printed by a critical task (e.g. an overload) is sent to every session, not just the one whose command is waiting
+  for(byte i=0;i<nTasks;i++){
+    t=task+i;
+    if(!(t->flags&TASK_CRITICAL))
+      continue;
+    elapsed=Clock::us()-t->lastRun;
+    if(elapsed>=t->period)
+      runTask(t,elapsed-t->period);
+  }
+  Session::current=s;
+  yielding=false;
+} // Scheduler::yield
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::parse(char *c){
+  int n;
+
+  switch(sscanf_P(c,PSTR("%d"),&n)){
+
+    case 1:                     // argument is zero
+      if(n==0){
+        reset();
+        INTERFACE.print(MSG(MSG_OK));
+      } else{
+        INTERFACE.print(MSG(MSG_FAIL));
+      }
+    break;
+
+    case -1:                    // no arguments
+      show();
+    break;
+  }
+} // Scheduler::parse
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::show(){
+  Task *t;
+
+  for(byte i=0;i<nTasks;i++){
+    t=task+i;
+    INTERFACE.print(F("<K "));
+    INTERFACE.print(MSG(t->name));
+    INTERFACE.print(' ');
+    INTERFACE.print(t->period);
+    INTERFACE.print(' ');
+    INTERFACE.print(t->budget);
+    INTERFACE.print(' ');
+    INTERFACE.print(t->maxLatency);
+    INTERFACE.print(' ');
+    INTERFACE.print(t->maxRun);
+    INTERFACE.print(' ');
+    INTERFACE.print(t->nOverruns);
+    INTERFACE.print('>');
+  }
+} // Scheduler::show
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Scheduler::reset(){
+  for(byte i=0;i<nTasks;i++){
+    task[i].maxLatency=0;
+    task[i].maxRun=0;
+    task[i].nOverruns=0;
+  }
+} // Scheduler::reset
+
+///////////////////////////////////////////////////////////////////////////////
+
+Task Scheduler::task[SCHEDULER_MAX_TASKS];
+byte Scheduler::nTasks=0;
+boolean Scheduler::yielding=false;
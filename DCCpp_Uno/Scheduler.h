@@ -0,0 +1,54 @@
+/**********************************************************************
+
+Scheduler.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include "Arduino.h"
+#include "Histogram.h"
+
+#define  SCHEDULER_MAX_TASKS    8
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  SCHEDULER_HISTOGRAMS   0       // no run time histogram is kept for each task (to conserve SRAM)
+#else                                         // Configuration for MEGA
+  #define  SCHEDULER_HISTOGRAMS   1       // a run time histogram is kept for each task (see Histogram.cpp)
+#endif
+
+#define  TASK_CRITICAL          1       // task is also run from within Scheduler::yield() while a long operation is in progress
+
+struct Task{
+  const char *name;                     // stored in flash, e.g. PSTR("SERIAL")
+  void (*run)();
+  unsigned int period;                  // microseconds between runs (0=run on every pass through the main loop)
+  unsigned int budget;                  // microseconds each run is expected to take
+  byte flags;
+  unsigned long lastRun;
+  unsigned long maxLatency;             // longest time, in microseconds, the task was kept waiting past its scheduled time
+  unsigned long maxRun;                 // longest time, in microseconds, a single run of the task took
+  unsigned int nOverruns;               // number of runs that exceeded budget
+#if SCHEDULER_HISTOGRAMS
+  Histogram runTime;                    // distribution of the time taken by each run (see Histogram.cpp)
+#endif
+}; // Task
+
+struct Scheduler{
+  static Task task[SCHEDULER_MAX_TASKS];
+  static byte nTasks;
+  static boolean yielding;
+  static void add(const char *, void (*)(), unsigned int, unsigned int, byte=0);
+  static void run();
+  static void yield();
+  static void runTask(Task *, unsigned long);
+  static void parse(char *c);
+  static void show();
+  static void reset();
+}; // Scheduler
+
+#endif
@@ -26,7 +26,7 @@ sensor definitions using the following variation of the "S" command:
 
   <S ID PIN PULLUP>:           creates a new sensor ID, with specified PIN and PULLUP
                                if sensor ID already exists, it is updated with specificed PIN and PULLUP
-                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory)
+                               returns: <O> if successful and <X> if unsuccessful (e.g. out of memory, or PIN does not exist)
 
   <S ID>:                      deletes definition of sensor ID
                                returns: <O> if successful and <X> if unsuccessful (e.g. ID does not exist)
@@ -59,6 +59,11 @@ decide to ignore the <q ID> return and only react to <Q ID> triggers.
 #include "Sensor.h"
 #include "EEStore.h"
 #include <EEPROM.h>
+#include "Events.h"
+#include "Automation.h"
+#include "Reflex.h"
+#include "Recorder.h"
+#include "Messages.h"
 #include "Comm.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -71,14 +76,12 @@ void Sensor::check(){
     
     if(!tt->active && tt->signal<0.5){
       tt->active=true;
-      INTERFACE.print("<Q");
-      INTERFACE.print(tt->data.snum);
-      INTERFACE.print(">");
+      Recorder::sensor(tt->data.snum,true);
+      report(tt->data.snum,true);
     } else if(tt->active && tt->signal>0.9){
       tt->active=false;
-      INTERFACE.print("<q");
-      INTERFACE.print(tt->data.snum);
-      INTERFACE.print(">");
+      Recorder::sensor(tt->data.snum,false);
+      report(tt->data.snum,false);
     }
   } // loop over all sensors
     
@@ -86,6 +89,25 @@ void Sensor::check(){
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// REACTS TO, AND REPORTS, SENSOR SNUM BECOMING ACTIVE OR INACTIVE --- CALLED BY check() AND BY REPLAY OF A RECORDED LOG (SEE RECORDER.CPP)
+
+void Sensor::report(int snum, boolean active){
+  if(active){
+    Reflex::fire(snum);                                           // stop train first (see Reflex.cpp)
+    Automation::trigger(AUTOMATION_SENSOR_ON,snum);               // react before reporting (see Automation.cpp)
+  } else {
+    Automation::trigger(AUTOMATION_SENSOR_OFF,snum);
+  }
+
+  Messages::print(INTERFACE,PSTR("<%c%d>"),active?'Q':'q',snum);
+  if(Events::begin(EVENT_SENSOR)){
+    Messages::print(INTERFACE,PSTR("%c%d"),active?'Q':'q',snum);
+    Events::end();
+  }
+} // Sensor::report
+
+///////////////////////////////////////////////////////////////////////////////
+
 Sensor *Sensor::create(int snum, int pin, int pullUp, int v){
   Sensor *tt;
   
@@ -102,7 +124,7 @@ Sensor *Sensor::create(int snum, int pin, int pullUp, int v){
 
   if(tt==NULL){       // problem allocating memory
     if(v==1)
-      INTERFACE.print("<X>");
+      INTERFACE.print(MSG(MSG_FAIL));
     return(tt);
   }
   
@@ -115,7 +137,7 @@ Sensor *Sensor::create(int snum, int pin, int pullUp, int v){
   digitalWrite(pin,pullUp);   // don't use Arduino's internal pull-up resistors for external infrared sensors --- each sensor must have its own 1K external pull-up resistor
 
   if(v==1)
-    INTERFACE.print("<O>");
+    INTERFACE.print(MSG(MSG_OK));
   return(tt);
   
 }
@@ -135,7 +157,7 @@ void Sensor::remove(int n){
   for(tt=firstSensor;tt!=NULL && tt->data.snum!=n;pp=tt,tt=tt->nextSensor);
 
   if(tt==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
   
@@ -146,7 +168,7 @@ void Sensor::remove(int n){
 
   free(tt);
 
-  INTERFACE.print("<O>");
+  INTERFACE.print(MSG(MSG_OK));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -155,18 +177,12 @@ void Sensor::show(){
   Sensor *tt;
 
   if(firstSensor==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
     
   for(tt=firstSensor;tt!=NULL;tt=tt->nextSensor){
-    INTERFACE.print("<Q");
-    INTERFACE.print(tt->data.snum);
-    INTERFACE.print(" ");
-    INTERFACE.print(tt->data.pin);
-    INTERFACE.print(" ");
-    INTERFACE.print(tt->data.pullUp);
-    INTERFACE.print(">");
+    Messages::print(INTERFACE,PSTR("<Q%d %d %d>"),tt->data.snum,tt->data.pin,tt->data.pullUp);
   }
 }
 
@@ -176,14 +192,12 @@ void Sensor::status(){
   Sensor *tt;
 
   if(firstSensor==NULL){
-    INTERFACE.print("<X>");
+    INTERFACE.print(MSG(MSG_FAIL));
     return;
   }
     
   for(tt=firstSensor;tt!=NULL;tt=tt->nextSensor){
-    INTERFACE.print(tt->active?"<Q":"<q");
-    INTERFACE.print(tt->data.snum);
-    INTERFACE.print(">");
+    Messages::print(INTERFACE,PSTR("<%c%d>"),tt->active?'Q':'q',tt->data.snum);
   }
 }
 
@@ -193,10 +207,13 @@ void Sensor::parse(char *c){
   int n,s,m;
   Sensor *t;
   
-  switch(sscanf(c,"%d %d %d",&n,&s,&m)){
+  switch(sscanf_P(c,PSTR("%d %d %d"),&n,&s,&m)){
     
     case 3:                     // argument is string with id number of sensor followed by a pin number and pullUp indicator (0=LOW/1=HIGH)
-      create(n,s,m,1);
+      if(s<0 || s>=NUM_DIGITAL_PINS)
+        INTERFACE.print(MSG(MSG_FAIL));
+      else
+        create(n,s,m,1);
     break;
 
     case 1:                     // argument is a string with id number only
@@ -208,7 +225,7 @@ void Sensor::parse(char *c){
     break;
 
     case 2:                     // invalid number of arguments
-      INTERFACE.print("<X>");
+      INTERFACE.print(MSG(MSG_FAIL));
       break;
   }
 }
@@ -13,6 +13,8 @@ Part of DCC++ BASE STATION for the Arduino
 #include "Arduino.h"
 
 #define  SENSOR_DECAY  0.03
+#define  SENSOR_SAMPLE_TIME  500      // microseconds between sensor samples (see Clock.h and Scheduler.h), so that de-bouncing takes the same time regardless of how fast the main loop runs
+#define  SENSOR_SAMPLE_BUDGET  200    // microseconds expected to sample all sensors
 
 struct SensorData {
   int snum;
@@ -35,6 +37,7 @@ struct Sensor{
   static void status();
   static void parse(char *c);
   static void check();   
+  static void report(int, boolean);
 }; // Sensor
 
 #endif
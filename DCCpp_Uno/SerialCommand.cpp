@@ -19,68 +19,108 @@ Part of DCC++ BASE STATION for the Arduino
 #include "Accessories.h"
 #include "Sensor.h"
 #include "Outputs.h"
+#include "Routes.h"
+#include "Automation.h"
+#include "Reflex.h"
+#include "Recorder.h"
+#include "ParseCost.h"
+#include "Scheduler.h"
+#include "Counters.h"
+#include "Histogram.h"
+#include "PacketTrace.h"
+#include "Events.h"
 #include "EEStore.h"
+#include "Messages.h"
 #include "Comm.h"
 
 extern int __heap_start, *__brkval;
 
 ///////////////////////////////////////////////////////////////////////////////
 
-char SerialCommand::commandString[MAX_COMMAND_LENGTH+1];
 volatile RegisterList *SerialCommand::mRegs;
 volatile RegisterList *SerialCommand::pRegs;
 CurrentMonitor *SerialCommand::mMonitor;
+CurrentMonitor *SerialCommand::pMonitor;
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void SerialCommand::init(volatile RegisterList *_mRegs, volatile RegisterList *_pRegs, CurrentMonitor *_mMonitor){
+void SerialCommand::init(volatile RegisterList *_mRegs, volatile RegisterList *_pRegs, CurrentMonitor *_mMonitor, CurrentMonitor *_pMonitor){
   mRegs=_mRegs;
   pRegs=_pRegs;
   mMonitor=_mMonitor;
-  sprintf(commandString,"");
+  pMonitor=_pMonitor;
 } // SerialCommand:SerialCommand
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void SerialCommand::process(){
-  char c;
-    
-  #if COMM_TYPE == 0
-
-    while(INTERFACE.available()>0){                       // while there is data on the serial line
-     c=INTERFACE.read();
-     if(c=='<')                                           // start of new command
-       sprintf(commandString,"");
-     else if(c=='>')                                      // end of new command
-       parse(commandString);                    
-     else if(strlen(commandString)<MAX_COMMAND_LENGTH)    // if comandString still has space, append character just read from serial line
-       sprintf(commandString,"%s%c",commandString,c);     // otherwise, character is ignored (but continue to look for '<' or '>')
-    } // while
-  
-  #elif COMM_TYPE == 1
-
-    EthernetClient client=INTERFACE.available();
-
-    if(client){
-      while(client.connected() && client.available()){    // while there is data on the network
-      c=client.read();
-      if(c=='<')                                          // start of new command
-        sprintf(commandString,"");
-      else if(c=='>')                                     // end of new command
-        parse(commandString);                    
-      else if(strlen(commandString)<MAX_COMMAND_LENGTH)   // if comandString still has space, append character just read from network
-        sprintf(commandString,"%s%c",commandString,c);    // otherwise, character is ignored (but continue to look for '<' or '>')
-      } // while
+///////////////////////////////////////////////////////////////////////////////
+
+void SerialCommand::batch(char *s){
+  char *c;
+  int n,a,b,d,e;
+  int status;
+  byte statusList[MAX_COMMAND_LENGTH/2];                  // every command in batch takes at least two characters, including its separator
+  int nStatus=0;
+  Turnout *t;
+  Output *o;
+
+  mRegs->beginDeferred();
+
+  for(c=strtok(s,"|");c!=NULL;c=strtok(NULL,"|")){
+    while(*c==' ')                                        // skip any spaces preceding the command
+      c++;
+    status=BATCH_ERR_INVALID;
+    switch(c[0]){
+      case 't':
+        if(sscanf_P(c+1,PSTR("%d %d %d %d"),&a,&b,&d,&e)==4)
+          status=mRegs->setThrottle(a,b,d,e)==0?0:BATCH_ERR_INVALID;
+        break;
+      case 'f':
+        if((n=sscanf_P(c+1,PSTR("%d %d %d"),&a,&b,&d))>=2)
+          status=mRegs->setFunction(a,b,(n==2)?-1:d);
+        break;
+      case 'a':
+        if(sscanf_P(c+1,PSTR("%d %d %d"),&a,&b,&d)==3)
+          status=mRegs->setAccessory(a,b,d);
+        break;
+      case 'T':
+        if(sscanf_P(c+1,PSTR("%d %d"),&a,&b)==2 && (t=Turnout::get(a))!=NULL){
+          t->activate(b,0);
+          status=0;
+        }
+        break;
+      case 'Z':
+        if(sscanf_P(c+1,PSTR("%d %d"),&a,&b)==2 && (o=Output::get(a))!=NULL){
+          o->activate(b,0);
+          status=0;
+        }
+        break;
+      default:
+        status=BATCH_ERR_UNSUPPORTED;
+        break;
     }
+    statusList[nStatus++]=status;
+  }
 
-  #endif
+  mRegs->commitDeferred();                                // place all throttle updates on track together
+
+  INTERFACE.print(F("<+"));
+  for(int i=0;i<nStatus;i++){
+    if(i>0)
+      INTERFACE.print(' ');
+    INTERFACE.print(statusList[i]);
+  }
+  INTERFACE.print('>');
+} // SerialCommand::batch
 
-} // SerialCommand:process
-   
 ///////////////////////////////////////////////////////////////////////////////
 
 void SerialCommand::parse(char *com){
   
+  Counters::nCommands++;
+  Recorder::command(com);                     // record command, if recording is in progress (see Recorder.cpp)
+  ParseCost::begin(com);                      // time command, retaining the most expensive (see ParseCost.cpp)
+
   switch(com[0]){
 
 /***** SET ENGINE THROTTLES USING 128-STEP SPEED CONTROL ****/    
@@ -94,12 +134,28 @@ void SerialCommand::parse(char *com){
  *    SPEED: throttle speed from 0-126, or -1 for emergency stop (resets SPEED to 0)
  *    DIRECTION: 1=forward, 0=reverse.  Setting direction when speed=0 or speed=-1 only effects directionality of cab lighting for a stopped train
  *    
- *    returns: <T REGISTER SPEED DIRECTION>
+ *    returns: <T REGISTER SPEED DIRECTION>, or <X> if any parameter is missing or out of range (e.g. a REGISTER below 1)
  *    
  */
       mRegs->setThrottle(com+1);
       break;
 
+/***** APPLY A BATCH OF COMMANDS WITH A SINGLE COMBINED REPLY ****/    
+
+    case '+':       // <+ COMMAND|COMMAND|...>
+/*
+ *    applies a series of throttle, function, accessory, turn-out and output commands, in order, as if each had been sent separately,
+ *    except that all throttle updates are placed on the track together once the entire batch has been applied
+ *    
+ *    COMMAND: any <t>, <f>, <a>, <T ID THROW> or <Z ID STATE> command, without its < > brackets
+ *    
+ *    returns: <+STATUS1 STATUS2 ...> with one STATUS for each COMMAND, in order, instead of the individual replies of each COMMAND
+ *    where STATUS = 0 if the COMMAND was applied, 1 if it was invalid (e.g. bad register, undefined turn-out, or missing parameters),
+ *    or 2 if the COMMAND cannot be used in a batch
+ */
+      batch(com+1);
+      break;
+
 /***** OPERATE ENGINE DECODER FUNCTIONS F0-F28 ****/    
 
     case 'f':       // <f CAB BYTE1 [BYTE2]>
@@ -134,7 +190,7 @@ void SerialCommand::parse(char *com){
  *    BYTE1: 223
  *    BYTE2: F21*1 + F22*2 + F23*4 + F24*8 + F25*16 + F26*32 + F27*64 + F28*128
  *   
- *    returns: NONE
+ *    returns: NONE, or <X> if any parameter is missing or out of range
  * 
  */
       mRegs->setFunction(com+1);
@@ -160,7 +216,7 @@ void SerialCommand::parse(char *com){
  *    ADDRESS = INT((N - 1) / 4) + 1
  *    SUBADDRESS = (N - 1) % 4
  *    
- *    returns: NONE
+ *    returns: NONE, or <X> if any parameter is missing or out of range
  */
       mRegs->setAccessory(com+1);
       break;
@@ -198,6 +254,43 @@ void SerialCommand::parse(char *com){
  */
       Output::parse(com+1);
       break;
+
+/***** CREATE/REMOVE/SHOW AUTOMATION HANDLERS  ****/    
+
+    case 'A':       // <A TRIGGER ID ACTION ARGS>
+/*
+ *   *** SEE AUTOMATION.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "A" COMMAND
+ *   USED TO DEFINE ACTIONS CARRIED OUT AUTOMATICALLY WHEN A SENSOR, TURNOUT, OR TIMER IS TRIGGERED
+ */
+      Automation::parse(com+1);
+      break;
+
+/***** CREATE/REMOVE/SHOW STOP REFLEXES  ****/    
+
+    case 'V':       // <V ID REGISTER CAB ACTION SPEED>
+/*
+ *   *** SEE REFLEX.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "V" COMMAND
+ *   USED TO STOP A TRAIN IMMEDIATELY WHEN IT TRIGGERS A SENSOR
+ */
+      Reflex::parse(com+1);
+      break;
+
+/***** CREATE/EDIT/REMOVE/SHOW & FIRE A ROUTE  ****/    
+
+    case 'U':       // <U ID ACTION>
+/*
+ *   <U ID ACTION>:            fires (ACTION=1) all of the turnouts and outputs defined in route ID, or cancels (ACTION=0) a firing still in progress
+ *   
+ *   ID: the numeric ID (0-32767) of the route to fire
+ *   ACTION: 1 (fire) or 0 (cancel)
+ *   
+ *   returns: <u ID NSET NMISSING> once the route has been fully set, or <X> if route ID does not exist
+ *   
+ *   *** SEE ROUTES.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "U" COMMAND
+ *   USED TO CREATE/EDIT/REMOVE/SHOW ROUTE DEFINITIONS
+ */
+      Route::parse(com+1);
+      break;
       
 /***** CREATE/EDIT/REMOVE/SHOW A SENSOR  ****/    
 
@@ -228,7 +321,7 @@ void SerialCommand::parse(char *com){
  *    CV: the number of the Configuration Variable memory location in the decoder to write to (1-1024)
  *    VALUE: the value to be written to the Configuration Variable memory location (0-255)
  *    
- *    returns: NONE
+ *    returns: NONE, or <X> if any argument is out of range
 */    
       mRegs->writeCVByteMain(com+1);
       break;      
@@ -244,7 +337,7 @@ void SerialCommand::parse(char *com){
  *    BIT: the bit number of the Configurarion Variable regsiter to write (0-7)
  *    VALUE: the value of the bit to be written (0-1)
  *    
- *    returns: NONE
+ *    returns: NONE, or <X> if any argument is out of range
 */        
       mRegs->writeCVBitMain(com+1);
       break;      
@@ -262,6 +355,7 @@ void SerialCommand::parse(char *com){
  *    
  *    returns: <r CALLBACKNUM|CALLBACKSUB|CV Value)
  *    where VALUE is a number from 0-255 as read from the requested CV, or -1 if verificaiton read fails
+ *    or <X> if CV or VALUE is out of range
 */    
       pRegs->writeCVByte(com+1);
       break;      
@@ -280,50 +374,104 @@ void SerialCommand::parse(char *com){
  *    
  *    returns: <r CALLBACKNUM|CALLBACKSUB|CV BIT VALUE)
  *    where VALUE is a number from 0-1 as read from the requested CV bit, or -1 if verificaiton read fails
+ *    or <X> if CV, BIT, or VALUE is out of range
 */    
       pRegs->writeCVBit(com+1);
       break;      
 
 /***** READ CONFIGURATION VARIABLE BYTE FROM ENGINE DECODER ON PROGRAMMING TRACK  ****/    
 
-    case 'R':     // <R CV CALLBACKNUM CALLBACKSUB>
+    case 'R':     // <R CV CALLBACKNUM CALLBACKSUB [HINT1 ... HINT4]>
 /*    
  *    reads a Configuration Variable from the decoder of an engine on the programming track
  *    
  *    CV: the number of the Configuration Variable memory location in the decoder to read from (1-1024)
  *    CALLBACKNUM: an arbitrary integer (0-32767) that is ignored by the Base Station and is simply echoed back in the output - useful for external programs that call this function
  *    CALLBACKSUB: a second arbitrary integer (0-32767) that is ignored by the Base Station and is simply echoed back in the output - useful for external programs (e.g. DCC++ Interface) that call this function
+ *    HINT1-HINT4: optional candidate values (0-255) that the CV is expected to contain.  Each is checked with a single byte-verify before
+ *                 falling back to a full bit-by-bit read, which is several times faster when one of them is correct.  If omitted, the value
+ *                 most recently written to this CV with the <W> command, if any, is used as a candidate
  *    
  *    returns: <r CALLBACKNUM|CALLBACKSUB|CV VALUE)
- *    where VALUE is a number from 0-255 as read from the requested CV, or -1 if read could not be verified
+ *    where VALUE is a number from 0-255 as read from the requested CV, or -1 if read could not be verified or CV is out of range
 */    
       pRegs->readCV(com+1);
       break;
 
+/***** READ A BATCH OF CONFIGURATION VARIABLE BYTES FROM ENGINE DECODER ON PROGRAMMING TRACK  ****/    
+
+    case 'J':     // <J CALLBACKNUM CALLBACKSUB [CV1 CV2 ... CV8]>
+/*    
+ *    identifies the decoder of an engine on the programming track and reads up to 8 Configuration Variables from it in a single command
+ *    CVs previously read from the same decoder are confirmed with a single byte-verify of the value in the roster cache, rather than re-read bit by bit (see ROSTER.CPP)
+ *    
+ *    CALLBACKNUM: an arbitrary integer (0-32767) that is ignored by the Base Station and is simply echoed back in the output - useful for external programs that call this function
+ *    CALLBACKSUB: a second arbitrary integer (0-32767) that is ignored by the Base Station and is simply echoed back in the output - useful for external programs (e.g. DCC++ Interface) that call this function
+ *    CV1-CV8: the numbers of the Configuration Variable memory locations to read (1-1024).  If omitted, CVs 1, 7, 8, and 29 are read
+ *    
+ *    returns: <j CALLBACKNUM|CALLBACKSUB|ADDRESS MFR VERSION|CV1 VALUE1|CV2 VALUE2|...|NCACHED TIME>
+ *    where ADDRESS is the active short or long address of the decoder, MFR and VERSION are the values of CV8 and CV7,
+ *    each VALUE is a number from 0-255 as read from the corresponding CV, or -1 if it could not be verified,
+ *    NCACHED is the number of values confirmed from the roster cache, and TIME is the total time taken in milliseconds
+*/    
+      pRegs->readCVBatch(com+1);
+      break;
+
 /***** TURN ON POWER FROM MOTOR SHIELD TO TRACKS  ****/    
 
     case '1':      // <1>
 /*   
- *    enables power from the motor shield to the main operations and programming tracks
+ *    enables power from the motor shield to the main operations and programming tracks, and to any additional main operations
+ *    track districts, clearing any prior overloads
  *    
  *    returns: <p1>
+ *    
+ *    NOTE: each track is separately shut off if its current exceeds CURRENT_LIMIT_MAIN or CURRENT_LIMIT_PROG (see Config.h and DCCpp_Uno.h),
+ *    returning <p2> (main operations track) or <p3> (programming track).  The overloaded track is then automatically re-tried,
+ *    returning <p1 MAIN> or <p1 PROG> when re-enabled, with increasing delays if the overload persists (see CurrentMonitor.h)
+ *    
+ *    Each additional main operations track district is likewise separately shut off, returning <p2 DISTRICT>, and re-tried,
+ *    returning <p1 MAIN DISTRICT>, without interrupting the packets sent to the other districts
+ *    
+ *   *** ALTERNATIVELY, TO RE-ENABLE A SINGLE MAIN OPERATIONS TRACK DISTRICT WITHOUT AFFECTING ANY OTHER: ***
+ *    
+ *    <1 DISTRICT>
+ *    
+ *    DISTRICT: 0 = main operations track (motor shield channel A), 1-MAIN_DISTRICTS = additional district (see Config.h)
+ *    
+ *    returns: <p1 MAIN> or <p1 MAIN DISTRICT>, or <X> if DISTRICT is invalid
  */    
-     digitalWrite(SIGNAL_ENABLE_PIN_PROG,HIGH);
-     digitalWrite(SIGNAL_ENABLE_PIN_MAIN,HIGH);
-     INTERFACE.print("<p1>");
+     int d;
+     if(sscanf_P(com+1,PSTR("%d"),&d)==1){
+       if(d<0 || d>MAIN_DISTRICTS){
+         INTERFACE.print(MSG(MSG_FAIL));
+       } else {
+         mMonitor[d].power(1);
+         mMonitor[d].report(true);
+       }
+       break;
+     }
+     pMonitor->power(1);
+     for(d=0;d<=MAIN_DISTRICTS;d++)
+       mMonitor[d].power(1);
+     INTERFACE.print(MSG(MSG_POWER_ON));
+     Events::message(EVENT_POWER,MSG_POWER_ON);
      break;
           
 /***** TURN OFF POWER FROM MOTOR SHIELD TO TRACKS  ****/    
 
     case '0':     // <0>
 /*   
- *    disables power from the motor shield to the main operations and programming tracks
+ *    disables power from the motor shield to the main operations and programming tracks, and to any additional main operations
+ *    track districts
  *    
  *    returns: <p0>
  */
-     digitalWrite(SIGNAL_ENABLE_PIN_PROG,LOW);
-     digitalWrite(SIGNAL_ENABLE_PIN_MAIN,LOW);
-     INTERFACE.print("<p0>");
+     pMonitor->power(0);
+     for(int i=0;i<=MAIN_DISTRICTS;i++)
+       mMonitor[i].power(0);
+     INTERFACE.print(MSG(MSG_POWER_OFF));
+     Events::message(EVENT_POWER,MSG_POWER_OFF);
      break;
 
 /***** READ MAIN OPERATIONS TRACK CURRENT  ****/    
@@ -334,10 +482,37 @@ void SerialCommand::parse(char *com){
  *    
  *    returns: <a CURRENT> 
  *    where CURRENT = 0-1024, based on exponentially-smoothed weighting scheme
+ *    
+ *   *** ALTERNATIVELY, TO DUMP THE RECENT CURRENT HISTORY OF EITHER TRACK: ***
+ *    
+ *    <c TRACK>
+ *    
+ *    TRACK: 0 = main operations track, 1 = programming track, 2-(MAIN_DISTRICTS+1) = additional main operations track district TRACK-1
+ *    
+ *    returns: <a TRACK CURRENT MIN MAX MEAN PEAK TRIPS|HEX>
+ *    where CURRENT = 0-1024, based on exponentially-smoothed weighting scheme
+ *          MIN, MAX, MEAN = 0-1024, computed over all entries in the history ring of the track
+ *          PEAK = 0-1024, the largest single current sample since the history was last dumped
+ *          TRIPS = the number of times the track has been shut off due to an overload since start-up
+ *          HEX = two hex digits per history entry, oldest first, each holding the largest current sample (divided by 4)
+ *                out of every CURRENT_RING_DECIMATE samples (see CurrentMonitor.h)
+ *    or <X> if TRACK is invalid
  */
-      INTERFACE.print("<a");
+      int t;
+      if(sscanf_P(com+1,PSTR("%d"),&t)==1){
+        if(t==0)
+          mMonitor->dump(0);
+        else if(t==1)
+          pMonitor->dump(1);
+        else if(t>1 && t<=MAIN_DISTRICTS+1)
+          mMonitor[t-1].dump(t);
+        else
+          INTERFACE.print(MSG(MSG_FAIL));
+        break;
+      }
+      INTERFACE.print(F("<a"));
       INTERFACE.print(int(mMonitor->current));
-      INTERFACE.print(">");
+      INTERFACE.print('>');
       break;
 
 /***** READ STATUS OF DCC++ BASE STATION  ****/    
@@ -349,45 +524,43 @@ void SerialCommand::parse(char *com){
  *    
  *    returns: series of status messages that can be read by an interface to determine status of DCC++ Base Station and important settings
  */
-      if(digitalRead(SIGNAL_ENABLE_PIN_PROG)==LOW)      // could check either PROG or MAIN
-        INTERFACE.print("<p0>");
-      else
-        INTERFACE.print("<p1>");
+      int on;
+      on=(pMonitor->state!=CURRENT_OFF);
+      for(int i=0;i<=MAIN_DISTRICTS;i++)
+        on|=(mMonitor[i].state!=CURRENT_OFF);
+      INTERFACE.print(MSG(on?MSG_POWER_ON:MSG_POWER_OFF));
+
+      for(int i=0;i<=MAIN_DISTRICTS;i++){
+        if(mMonitor[i].state!=CURRENT_ON && mMonitor[i].overloaded)     // main operations track (or district) is off due to an overload
+          mMonitor[i].print(false);
+      }
+      if(pMonitor->state!=CURRENT_ON && pMonitor->overloaded)        // programming track is off due to an overload
+        INTERFACE.print(MSG(pMonitor->msg));
 
       for(int i=1;i<=MAX_MAIN_REGISTERS;i++){
         if(mRegs->speedTable[i]==0)
           continue;
-        INTERFACE.print("<T");
-        INTERFACE.print(i); INTERFACE.print(" ");
+        INTERFACE.print(F("<T"));
+        INTERFACE.print(i); INTERFACE.print(' ');
         if(mRegs->speedTable[i]>0){
           INTERFACE.print(mRegs->speedTable[i]);
-          INTERFACE.print(" 1>");
+          INTERFACE.print(F(" 1>"));
         } else{
           INTERFACE.print(-mRegs->speedTable[i]);
-          INTERFACE.print(" 0>");
+          INTERFACE.print(F(" 0>"));
         }          
       }
-      INTERFACE.print("<iDCC++ BASE STATION FOR ARDUINO ");
-      INTERFACE.print(ARDUINO_TYPE);
-      INTERFACE.print(" / ");
-      INTERFACE.print(MOTOR_SHIELD_NAME);
-      INTERFACE.print(": V-");
-      INTERFACE.print(VERSION);
-      INTERFACE.print(" / ");
-      INTERFACE.print(__DATE__);
-      INTERFACE.print(" ");
-      INTERFACE.print(__TIME__);
-      INTERFACE.print(">");
-
-      INTERFACE.print("<N");
+      INTERFACE.print(MSG(MSG_BANNER));
+
+      INTERFACE.print(F("<N"));
       INTERFACE.print(COMM_TYPE);
-      INTERFACE.print(": ");
+      INTERFACE.print(F(": "));
 
       #if COMM_TYPE == 0
-        INTERFACE.print("SERIAL>");
+        INTERFACE.print(F("SERIAL>"));
       #elif COMM_TYPE == 1
         INTERFACE.print(Ethernet.localIP());
-        INTERFACE.print(">");
+        INTERFACE.print('>');
       #endif
       
       Turnout::show();
@@ -395,23 +568,100 @@ void SerialCommand::parse(char *com){
                         
       break;
 
+/***** SHOW/RESET TASK SCHEDULING STATISTICS  ****/    
+
+    case 'K':     // <K>
+/*
+ *   *** SEE SCHEDULER.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "K" COMMAND
+ *   USED TO SHOW AND RESET TASK SCHEDULING STATISTICS
+ */
+      Scheduler::parse(com+1);
+      break;
+
+/***** SHOW/RESET PERFORMANCE COUNTERS  ****/    
+
+    case 'G':     // <G>
+/*
+ *   *** SEE COUNTERS.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "G" COMMAND
+ *   USED TO SHOW AND RESET PERFORMANCE COUNTERS
+ */
+      Counters::parse(com+1);
+      break;
+
+/***** SHOW/RESET MOST EXPENSIVE COMMANDS  ****/    
+
+    case 'y':     // <y>
+/*
+ *   *** SEE PARSECOST.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "y" COMMAND
+ *   USED TO SHOW AND RESET THE MOST EXPENSIVE COMMANDS RECEIVED
+ */
+      ParseCost::parse(com+1);
+      break;
+
+/***** SHOW/RESET TIMING HISTOGRAMS  ****/    
+
+    case 'l':     // <l>
+/*
+ *   *** SEE HISTOGRAM.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "l" COMMAND
+ *   USED TO SHOW AND RESET TIMING HISTOGRAMS
+ */
+      Histogram::parse(com+1);
+      break;
+
+/***** SHOW TRACE OF RECENT MAIN OPERATIONS TRACK PACKETS  ****/    
+
+    case '*':     // <*>
+/*
+ *    returns: <* REG: B1 B2 ... Bn CSUM / REPEAT @ TIME> for each recent packet, followed by <* DROPPED>
+ *    
+ *   *** SEE PACKETTRACE.CPP FOR COMPLETE INFO
+ */
+      PacketTrace::show();
+      break;
+
+/***** SUBSCRIBE TO EVENTS OR CHECK FOR MISSED EVENTS  ****/    
+
+    case '@':     // <@ MASK [THRESHOLD]>
+/*
+ *   *** SEE EVENTS.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "@" COMMAND
+ *   USED TO SUBSCRIBE TO EVENTS AND CHECK WHETHER ANY HAVE BEEN MISSED
+ */
+      Events::parse(com+1);
+      break;
+
+/***** RECORD/REPLAY COMMAND AND SENSOR LOGS  ****/    
+
+    case '%':     // <%>
+/*
+ *   *** SEE RECORDER.CPP FOR COMPLETE INFO ON THE DIFFERENT VARIATIONS OF THE "%" COMMAND
+ *   USED TO RECORD, DUMP, LOAD, AND REPLAY LOGS OF COMMANDS AND SENSOR TRANSITIONS
+ */
+      Recorder::parse(com+1);
+      break;
+
 /***** STORE SETTINGS IN EEPROM  ****/    
 
     case 'E':     // <E>
 /*
- *    stores settings for turnouts and sensors EEPROM
+ *    stores settings for turnouts, sensors, outputs, routes, stop reflexes, and automation handlers in EEPROM
  *    
- *    returns: <e nTurnouts nSensors>
+ *    returns: <e nTurnouts nSensors nOutputs nRoutes nReflexes nAutomationBytes>
 */
      
     EEStore::store();
-    INTERFACE.print("<e ");
+    INTERFACE.print(F("<e "));
     INTERFACE.print(EEStore::eeStore->data.nTurnouts);
-    INTERFACE.print(" ");
+    INTERFACE.print(' ');
     INTERFACE.print(EEStore::eeStore->data.nSensors);
-    INTERFACE.print(" ");
+    INTERFACE.print(' ');
     INTERFACE.print(EEStore::eeStore->data.nOutputs);
-    INTERFACE.print(">");
+    INTERFACE.print(' ');
+    INTERFACE.print(EEStore::eeStore->data.nRoutes);
+    INTERFACE.print(' ');
+    INTERFACE.print(EEStore::eeStore->data.nReflexes);
+    INTERFACE.print(' ');
+    INTERFACE.print(EEStore::eeStore->data.nAutomation);
+    INTERFACE.print('>');
     break;
     
 /***** CLEAR SETTINGS IN EEPROM  ****/    
@@ -424,7 +674,7 @@ void SerialCommand::parse(char *com){
 */
      
     EEStore::clear();
-    INTERFACE.print("<O>");
+    INTERFACE.print(MSG(MSG_OK));
     break;
 
 /***** PRINT CARRIAGE RETURN IN SERIAL MONITOR WINDOW  ****/    
@@ -435,7 +685,7 @@ void SerialCommand::parse(char *com){
  *    
  *    returns: a carriage return
 */
-      INTERFACE.println("");
+      INTERFACE.println();
       break;  
 
 ///          
@@ -451,7 +701,7 @@ void SerialCommand::parse(char *com){
  *    SERIAL COMMUNICAITON WILL BE INTERUPTED ONCE THIS COMMAND IS ISSUED - MUST RESET BOARD OR RE-OPEN SERIAL WINDOW TO RE-ESTABLISH COMMS
  */
 
-    Serial.println("\nEntering Diagnostic Mode...");
+    Serial.println(F("\nEntering Diagnostic Mode..."));
     delay(1000);
     
     bitClear(TCCR1B,CS12);    // set Timer 1 prescale=8 - SLOWS NORMAL SPEED BY FACTOR OF 8
@@ -517,7 +767,7 @@ void SerialCommand::parse(char *com){
             
 /***** ATTEMPTS TO DETERMINE HOW MUCH FREE SRAM IS AVAILABLE IN ARDUINO  ****/        
       
-    case 'F':     // <F>
+    case 'F':     // <F> or <F 1>
 /*
  *     measure amount of free SRAM memory left on the Arduino based on trick found on the internet.
  *     Useful when setting dynamic array sizes, considering the Uno only has 2048 bytes of dynamic SRAM.
@@ -525,11 +775,27 @@ void SerialCommand::parse(char *com){
  *     
  *     returns: <f MEM>
  *     where MEM is the number of free bytes remaining in the Arduino's SRAM
+ *
+ *     <F 1> also reports what the free SRAM, less SRAM_STACK_RESERVE bytes left for the stack, could be used for instead
+ *
+ *     returns: <f MEM REGISTERS TURNOUTS SENSORS OUTPUTS ROUTE_ENTRIES>
+ *     where REGISTERS is the number of Main Track Registers that could be added to MAX_MAIN_REGISTERS in Config.h,
+ *     and TURNOUTS, SENSORS, OUTPUTS, and ROUTE_ENTRIES are the number of each that could be defined in addition to those already defined
  */
-      int v; 
-      INTERFACE.print("<f");
-      INTERFACE.print((int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval));
-      INTERFACE.print(">");
+      int v, mem;
+      mem=(intptr_t) &v - (__brkval == 0 ? (intptr_t) &__heap_start : (intptr_t) __brkval);
+      INTERFACE.print(F("<f"));
+      INTERFACE.print(mem);
+      if(atoi(com+1)==1){
+        mem=max(mem-SRAM_STACK_RESERVE,0);
+        Messages::print(INTERFACE,PSTR(" %d %d %d %d %d"),
+          mem/(int)(sizeof(Register)+sizeof(Register *)+sizeof(int)),         // each register also has an entry in regMap and speedTable
+          mem/(int)(sizeof(Turnout)+SRAM_MALLOC_OVERHEAD),
+          mem/(int)(sizeof(Sensor)+SRAM_MALLOC_OVERHEAD),
+          mem/(int)(sizeof(Output)+SRAM_MALLOC_OVERHEAD),
+          mem/(int)sizeof(RouteEntry));
+      }
+      INTERFACE.print('>');
       break;
 
 /***** LISTS BIT CONTENTS OF ALL INTERNAL DCC PACKET REGISTERS  ****/        
@@ -539,31 +805,37 @@ void SerialCommand::parse(char *com){
  *    lists the packet contents of the main operations track registers and the programming track registers
  *    FOR DIAGNOSTIC AND TESTING USE ONLY
  */
-      INTERFACE.println("");
+      INTERFACE.println();
       for(Register *p=mRegs->reg;p<=mRegs->maxLoadedReg;p++){
-        INTERFACE.print("M"); INTERFACE.print((int)(p-mRegs->reg)); INTERFACE.print(":\t");
-        INTERFACE.print((int)p); INTERFACE.print("\t");
-        INTERFACE.print((int)p->activePacket); INTERFACE.print("\t");
-        INTERFACE.print(p->activePacket->nBits); INTERFACE.print("\t");
+        INTERFACE.print('M'); INTERFACE.print((int)(p-mRegs->reg)); INTERFACE.print(F(":\t"));
+        INTERFACE.print((int)(intptr_t)p); INTERFACE.print('\t');
+        INTERFACE.print((int)(intptr_t)p->activePacket); INTERFACE.print('\t');
+        INTERFACE.print(p->activePacket->nBits); INTERFACE.print('\t');
         for(int i=0;i<10;i++){
-          INTERFACE.print(p->activePacket->buf[i],HEX); INTERFACE.print("\t");
+          INTERFACE.print(p->activePacket->buf[i],HEX); INTERFACE.print('\t');
         }
-        INTERFACE.println("");
+        INTERFACE.println();
       }
       for(Register *p=pRegs->reg;p<=pRegs->maxLoadedReg;p++){
-        INTERFACE.print("P"); INTERFACE.print((int)(p-pRegs->reg)); INTERFACE.print(":\t");
-        INTERFACE.print((int)p); INTERFACE.print("\t");
-        INTERFACE.print((int)p->activePacket); INTERFACE.print("\t");
-        INTERFACE.print(p->activePacket->nBits); INTERFACE.print("\t");
+        INTERFACE.print('P'); INTERFACE.print((int)(p-pRegs->reg)); INTERFACE.print(F(":\t"));
+        INTERFACE.print((int)(intptr_t)p); INTERFACE.print('\t');
+        INTERFACE.print((int)(intptr_t)p->activePacket); INTERFACE.print('\t');
+        INTERFACE.print(p->activePacket->nBits); INTERFACE.print('\t');
         for(int i=0;i<10;i++){
-          INTERFACE.print(p->activePacket->buf[i],HEX); INTERFACE.print("\t");
+          INTERFACE.print(p->activePacket->buf[i],HEX); INTERFACE.print('\t');
         }
-        INTERFACE.println("");
+        INTERFACE.println();
       }
-      INTERFACE.println("");
+      INTERFACE.println();
+      break;
+
+    default:      // unrecognized command
+      Counters::nParseErrors++;
       break;
 
   } // switch
+
+  ParseCost::end();
 }; // SerialCommand::parse
 
 ///////////////////////////////////////////////////////////////////////////////
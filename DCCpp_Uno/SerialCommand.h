@@ -13,15 +13,24 @@ Part of DCC++ BASE STATION for the Arduino
 #include "PacketRegister.h"
 #include "CurrentMonitor.h"
 
-#define  MAX_COMMAND_LENGTH         30
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  MAX_COMMAND_LENGTH         64        // long enough for a batch of several short commands (see <+> command)
+#else                                         // Configuration for MEGA
+  #define  MAX_COMMAND_LENGTH         128
+#endif
+
+#define  BATCH_ERR_INVALID          1           // per-command status codes returned by <+> command
+#define  BATCH_ERR_UNSUPPORTED      2
+#define  SRAM_STACK_RESERVE         128         // bytes of free SRAM not counted as usable by <F 1>
+#define  SRAM_MALLOC_OVERHEAD       2           // bytes used by malloc() to keep track of each block allocated
+#define  SERIAL_COMMAND_BUDGET      2000        // microseconds expected to read and process a command (see Scheduler.h and Session.h)
 
 struct SerialCommand{
-  static char commandString[MAX_COMMAND_LENGTH+1];
   static volatile RegisterList *mRegs, *pRegs;
-  static CurrentMonitor *mMonitor;
-  static void init(volatile RegisterList *, volatile RegisterList *, CurrentMonitor *);
+  static CurrentMonitor *mMonitor, *pMonitor;    // mMonitor points to MAIN_DISTRICTS+1 monitors --- Main Track followed by any additional districts (see Config.h)
+  static void init(volatile RegisterList *, volatile RegisterList *, CurrentMonitor *, CurrentMonitor *);
   static void parse(char *);
-  static void process();
+  static void batch(char *);
 }; // SerialCommand
   
 #endif
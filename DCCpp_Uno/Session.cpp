@@ -0,0 +1,357 @@
+/**********************************************************************
+
+Session.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+DCC++ BASE STATION keeps a separate SESSION for each connection over which it receives commands.  For the serial
+interface there is a single session.  For the Ethernet interface there is one session for each connected client,
+up to TCP_SESSIONS (see Session.h), so that several throttles may be connected at once.  On the Mega, there is also
+a session for each additional hardware serial port (Serial1, Serial2, and/or Serial3) selected with SERIAL_PORTS in
+Config.h, so that (for example) a Bluetooth throttle bridge and a second computer may be connected at the same time
+as the main interface.
+
+Sessions are polled in turn, starting with a different session each time through the main loop, and no more than
+SESSION_COMMAND_QUOTA commands are read from any one session before moving on to the next.  Any further characters
+are left waiting until the next pass, so that a session sending a continuous stream of commands cannot hold up
+commands from the others.
+
+Each session has its own buffer for assembling text commands, its own binary frame receiver (see BinaryCommand.cpp),
+and its own transmit buffer.  A partially-received command from one client is therefore never mixed with
+characters received from another.
+
+All replies are printed to INTERFACE, which routes them as follows:
+
+  * replies to a command are returned only to the session from which that command was received
+  * events (see Events.cpp) are returned only to those sessions that subscribed to that class of event
+  * all other returns not prompted by a command (e.g. <Q ID> from a sensor, <p2> from an overload, or <u ID NSET NMISSING>
+    upon completion of a route) are broadcast to every session
+
+Replies are collected in each session's transmit buffer and written to its connection when the buffer fills, when
+all pending commands from that connection have been processed, or at the end of each pass through the main loop.
+This lets the Ethernet shield send a whole reply in one packet rather than one packet per print().
+
+When an Ethernet client disconnects, its session is freed for re-use.  If a new client connects while all sessions
+are in use, its connection is closed.
+
+If UDP_PORT is defined in Config.h, DCC++ BASE STATION also accepts commands sent as UDP datagrams to that port.
+This avoids the per-packet overhead of a TCP connection and suits throttles sending frequent speed updates, where
+a lost update is simply superseded by the next one.  Each peer (IP address and port) from which datagrams are received
+is given its own session, up to UDP_SESSIONS, and all replies and events for that session are returned to the peer as
+datagrams --- with the replies to each datagram returned together in a single datagram where they fit.  Since UDP has
+no connection to close, a peer's session is freed after no datagram has been received from it for UDP_SESSION_TIMEOUT
+milliseconds (see Session.h).  A peer that wants to keep receiving events should therefore send a command such as <@>
+more often than this.
+
+Each datagram contains one or more complete text or binary commands, optionally preceded by a sequence number:
+
+  #SEQ <COMMAND>...
+
+where
+
+  SEQ: a number (0-65535) that the peer increases by one with each datagram it sends
+
+A datagram whose SEQ is not later than that of the last datagram accepted from the same peer arrived out of order,
+and is dropped without being processed --- so that a stale speed update delayed in the network cannot override a newer
+one.  Comparison wraps around from 65535 to 1.  A SEQ of 0 is always accepted, allowing a peer to restart its numbering.
+Datagrams without a SEQ are always processed.
+
+**********************************************************************/
+
+#include "Session.h"
+#include "Counters.h"
+#include "Clock.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SessionReply::write(uint8_t c){
+  Session *s;
+
+  if(Session::eventClass==0 && Session::current!=NULL)      // reply to a command
+    return(Session::current->write(c));
+
+  for(s=Session::session;s<Session::session+MAX_SESSIONS;s++)             // event or broadcast
+    if(s->active && (Session::eventClass==0 || (s->eventMask&Session::eventClass)))
+      s->write(c);
+
+  return(1);
+} // SessionReply::write
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::open(byte t){
+  type=t;
+  nChars=0;
+  nTx=0;
+  eventMask=0;
+  eventSeq=0;
+  binary.state=BINARY_IDLE;
+  active=true;
+} // Session::open
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::receive(char c){
+
+  if(binary.receive(c))                             // character is part of a binary command (see BinaryCommand.cpp)
+    return;
+
+  if(c=='<')                                        // start of new command
+    nChars=0;
+  else if(c=='>'){                                  // end of new command
+    commandString[nChars]='\0';
+    SerialCommand::parse(commandString);
+    nChars=0;
+  } else if(nChars<MAX_COMMAND_LENGTH)              // if comandString still has space, append character just read
+    commandString[nChars++]=c;                      // otherwise, character is ignored (but continue to look for '<' or '>')
+
+} // Session::receive
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Session::write(uint8_t c){
+  if(!active)
+    return(0);
+  txBuf[nTx++]=c;
+  if(nTx==SESSION_TX_SIZE)
+    flush();
+  return(1);
+} // Session::write
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::flush(){
+  if(nTx==0)
+    return;
+
+  if(type==SESSION_SERIAL){
+    if(port->availableForWrite()<nTx)               // reply does not fit in transmit buffer --- will have to wait for it to drain
+      Counters::nTxStalls++;
+    port->write(txBuf,nTx);
+    nTx=0;
+    return;
+  }
+
+  #if COMM_TYPE == 1
+    #ifdef UDP_PORT
+      if(type==SESSION_UDP){
+        COMM_UDP.beginPacket(remoteIP,remotePort);
+        COMM_UDP.write(txBuf,nTx);
+        COMM_UDP.endPacket();
+        nTx=0;
+        return;
+      }
+    #endif
+    client.write(txBuf,nTx);
+  #endif
+
+  nTx=0;
+} // Session::flush
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS TRUE IF ANY SESSION HAS SUBSCRIBED TO EVENT CLASS E
+
+boolean Session::subscribed(byte e){
+  for(Session *s=session;s<session+MAX_SESSIONS;s++)
+    if(s->active && (s->eventMask&e))
+      return(true);
+  return(false);
+} // Session::subscribed
+
+///////////////////////////////////////////////////////////////////////////////
+
+// OPENS A SESSION FOR THE BUILT-IN SERIAL PORT (IF IT IS THE INTERFACE) AND FOR EACH ADDITIONAL SERIAL PORT SELECTED IN CONFIG.H
+
+void Session::begin(){
+  Session *s=session+NET_SESSIONS;
+
+  #if COMM_TYPE == 0
+    s->port=&Serial;                                // already begun by setup()
+    (s++)->open(SESSION_SERIAL);
+  #endif
+
+  #if (SERIAL_PORTS) & 1
+    Serial1.begin(SERIAL_PORTS_BAUD);
+    s->port=&Serial1;
+    (s++)->open(SESSION_SERIAL);
+  #endif
+
+  #if (SERIAL_PORTS) & 2
+    Serial2.begin(SERIAL_PORTS_BAUD);
+    s->port=&Serial2;
+    (s++)->open(SESSION_SERIAL);
+  #endif
+
+  #if (SERIAL_PORTS) & 4
+    Serial3.begin(SERIAL_PORTS_BAUD);
+    s->port=&Serial3;
+    (s++)->open(SESSION_SERIAL);
+  #endif
+
+} // Session::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+// READS CHARACTERS FROM IN UNTIL NONE ARE LEFT OR SESSION_COMMAND_QUOTA COMMANDS HAVE BEEN PROCESSED
+
+void Session::poll(Stream *in){
+  unsigned long n=Counters::nCommands;              // counts both text and binary commands
+
+  current=this;
+  while(in->available()>0 && Counters::nCommands-n<SESSION_COMMAND_QUOTA)
+    receive(in->read());
+} // Session::poll
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::process(){
+  Session *s;
+
+  #if COMM_TYPE == 1
+
+    EthernetClient client=COMM_PORT.available();    // returns a client with data waiting, if any
+
+    if(client){
+      for(s=session;s<session+TCP_SESSIONS && !(s->active && s->client==client);s++);
+      if(s==session+TCP_SESSIONS){                  // client is not yet in a session --- open a new one
+        for(s=session;s<session+TCP_SESSIONS && s->active;s++);
+        if(s==session+TCP_SESSIONS){                // all sessions are in use
+          client.stop();
+        } else{
+          s->client=client;
+          s->open(SESSION_TCP);
+        }
+      }
+    }
+
+  #endif
+
+  for(int i=0;i<MAX_SESSIONS;i++){                  // poll each session in turn, starting with a different session on each pass
+    s=session+(nextPoll+i)%MAX_SESSIONS;
+    if(!s->active)
+      continue;
+    if(s->type==SESSION_SERIAL)
+      s->poll(s->port);
+    #if COMM_TYPE == 1
+      else if(s->type==SESSION_TCP){
+        s->poll(&s->client);
+        if(!s->client.connected()){                 // client has disconnected --- free its session
+          s->client.stop();
+          s->active=false;
+        }
+      }
+    #endif
+  }
+
+  nextPoll=(nextPoll+1)%MAX_SESSIONS;
+
+  #if COMM_TYPE == 1
+
+    #ifdef UDP_PORT
+      int n;
+
+      for(int i=0;i<UDP_MAX_DATAGRAMS && (n=COMM_UDP.parsePacket())>0;i++){
+        s=getPeer(COMM_UDP.remoteIP(),COMM_UDP.remotePort());
+        if(s==NULL)                                 // all UDP sessions are in use --- datagram is ignored
+          continue;
+        current=s;
+        s->receiveDatagram(n);
+        s->flush();                                 // return replies to this datagram in a single datagram
+      }
+
+      for(s=session+TCP_SESSIONS;s<session+NET_SESSIONS;s++)      // free sessions of peers no longer sending datagrams
+        if(s->active && Clock::ms()-s->lastTime>UDP_SESSION_TIMEOUT)
+          s->active=false;
+    #endif
+
+  #endif
+
+  current=NULL;
+  flushAll();
+
+} // Session::process
+
+///////////////////////////////////////////////////////////////////////////////
+
+#if COMM_TYPE == 1 && defined(UDP_PORT)
+
+// RETURNS THE SESSION OF THE PEER AT IP ADDRESS IP AND PORT PORT, OPENING A NEW SESSION IF NEEDED, OR NULL IF NONE ARE FREE
+
+Session *Session::getPeer(IPAddress ip, unsigned int port){
+  Session *s;
+
+  for(s=session+TCP_SESSIONS;s<session+NET_SESSIONS && !(s->active && s->remoteIP==ip && s->remotePort==port);s++);
+
+  if(s==session+NET_SESSIONS){                      // first datagram from this peer
+    for(s=session+TCP_SESSIONS;s<session+NET_SESSIONS && s->active;s++);
+    if(s==session+NET_SESSIONS)
+      return(NULL);
+    s->remoteIP=ip;
+    s->remotePort=port;
+    s->seqValid=false;
+    s->open(SESSION_UDP);
+  }
+
+  s->lastTime=Clock::ms();
+  return(s);
+} // Session::getPeer
+
+///////////////////////////////////////////////////////////////////////////////
+
+// PROCESSES THE N BYTES OF A DATAGRAM JUST RECEIVED FROM THIS SESSION'S PEER
+
+void Session::receiveDatagram(int n){
+  int c;
+  unsigned int seq=0;
+
+  nChars=0;                                         // a command cannot continue from one datagram into the next
+  binary.state=BINARY_IDLE;
+
+  c=COMM_UDP.read();
+  n--;
+
+  if(c=='#'){                                       // datagram starts with a sequence number
+    while(n>0 && (c=COMM_UDP.read())>='0' && c<='9'){
+      seq=seq*10+(c-'0');
+      n--;
+    }
+    if(seq!=0 && seqValid && (int)(seq-lastSeq)<=0)   // datagram is out of order --- drop it
+      return;
+    lastSeq=seq;
+    seqValid=true;
+    if(n==0)
+      return;
+    n--;                                            // c is the character following the sequence number
+  }
+
+  for(;;){
+    receive(c);
+    if(n--==0)
+      break;
+    c=COMM_UDP.read();
+  }
+
+} // Session::receiveDatagram
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Session::flushAll(){
+  for(Session *s=session;s<session+MAX_SESSIONS;s++)
+    if(s->active)
+      s->flush();
+} // Session::flushAll
+
+///////////////////////////////////////////////////////////////////////////////
+
+Session Session::session[MAX_SESSIONS];
+Session *Session::current=NULL;
+byte Session::eventClass=0;
+SessionReply Session::reply;
+byte Session::nextPoll=0;
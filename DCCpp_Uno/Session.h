@@ -0,0 +1,97 @@
+/**********************************************************************
+
+Session.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+
+#ifndef Session_h
+#define Session_h
+
+#include "Arduino.h"
+#include "DCCpp_Uno.h"
+#include "SerialCommand.h"
+#include "BinaryCommand.h"
+#include "Comm.h"
+
+#ifdef ARDUINO_AVR_UNO                        // Configuration for UNO
+  #define  SESSION_TX_SIZE            32        // bytes of replies buffered per session before being written to its connection
+#else                                         // Configuration for MEGA
+  #define  SESSION_TX_SIZE            64
+#endif
+
+#if COMM_TYPE == 1
+  #define  TCP_SESSIONS               4         // one for each socket of the Ethernet shield
+  #ifdef UDP_PORT
+    #define  UDP_SESSIONS             4         // number of UDP peers that can be tracked at once
+  #else
+    #define  UDP_SESSIONS             0
+  #endif
+  #define  COMM_SERIAL_SESSIONS       0
+#else
+  #define  TCP_SESSIONS               0
+  #define  UDP_SESSIONS               0
+  #define  COMM_SERIAL_SESSIONS       1         // built-in Serial port is the interface
+#endif
+
+#define  SERIAL_SESSIONS              (COMM_SERIAL_SESSIONS+((SERIAL_PORTS)&1)+(((SERIAL_PORTS)>>1)&1)+(((SERIAL_PORTS)>>2)&1))
+#define  NET_SESSIONS                 (TCP_SESSIONS+UDP_SESSIONS)
+#define  MAX_SESSIONS                 (NET_SESSIONS+SERIAL_SESSIONS)     // sessions are ordered TCP, UDP, then serial
+
+#define  SESSION_COMMAND_QUOTA        2         // maximum number of commands read from each session before moving on to the next
+
+#define  UDP_SESSION_TIMEOUT          60000     // milliseconds without a datagram after which a UDP peer's session is freed
+#define  UDP_MAX_DATAGRAMS            4         // maximum number of datagrams processed in each pass through the main loop
+
+#define  SESSION_SERIAL               0
+#define  SESSION_TCP                  1
+#define  SESSION_UDP                  2
+
+struct SessionReply : public Print{           // INTERFACE --- routes each reply to the session being processed, or to all sessions
+  size_t write(uint8_t);
+  using Print::write;
+}; // SessionReply
+
+struct Session : public Print{
+  boolean active;
+  byte type;
+  HardwareSerial *port;                         // for SESSION_SERIAL
+  #if COMM_TYPE == 1
+    EthernetClient client;
+    #ifdef UDP_PORT
+      IPAddress remoteIP;
+      unsigned int remotePort;
+      unsigned int lastSeq;                     // sequence number of last datagram accepted from this peer
+      boolean seqValid;
+      unsigned long lastTime;                   // time (Clock::ms) last datagram was received from this peer
+      void receiveDatagram(int);
+      static Session *getPeer(IPAddress, unsigned int);
+    #endif
+  #endif
+  char commandString[MAX_COMMAND_LENGTH+1];
+  byte nChars;
+  BinaryCommand binary;
+  byte txBuf[SESSION_TX_SIZE];
+  byte nTx;
+  byte eventMask;
+  unsigned int eventSeq;
+  void open(byte);
+  void receive(char);
+  void poll(Stream *);
+  size_t write(uint8_t);
+  using Print::write;
+  void flush();
+  static Session session[MAX_SESSIONS];
+  static Session *current;
+  static byte eventClass;
+  static SessionReply reply;
+  static byte nextPoll;
+  static void begin();
+  static boolean subscribed(byte);
+  static void process();
+  static void flushAll();
+}; // Session
+
+#endif
@@ -0,0 +1,163 @@
+/**********************************************************************
+
+AckReplay.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+AckReplay replays programming track current traces through the sketch's own AckDetector (see AckDetector.cpp)
+on a host computer, and checks that each CV verify in the trace is decided as expected.  It is NOT part of the
+sketch and must not be placed in the DCCpp_Uno folder.  It runs on any host with a C++11 compiler, and is
+compiled and run from the tools folder with:
+
+  g++ -std=c++11 -O2 -Ihost -o AckReplay AckReplay.cpp ../DCCpp_Uno/AckDetector.cpp
+  ./AckReplay traces/clean_ack.trace traces/late_ack.trace traces/no_ack.trace traces/motor_noise.trace
+
+Each trace holds the analogRead() values of the programming track current, in the order the Base Station would
+take them, as whitespace-separated integers grouped into sections:
+
+  base                 the ACK_BASE_COUNT samples of the idle current taken once before the verifies of a CV (see ackBase)
+  verify EXPECT        the samples taken after one verify packet, where EXPECT is 1 if the decoder acknowledged it and 0 if not
+
+A trace may contain any number of base and verify sections, and everything from a # to the end of a line is a comment.
+If the samples of a verify section run out before the detector has decided, the window is taken to have ended without
+an acknowledgement, just as when the Base Station reaches ACK_SAMPLE_COUNT.  For each verify AckReplay prints the
+result, the number of samples the detector needed (and so how early it ended the window), the threshold it learned
+from the baseline, and whether the result matched EXPECT.  It exits with status 1 if any result did not match.
+
+The traces in the traces folder cover a clean acknowledgement, an acknowledgement that starts as late in the window as
+it does on the track, no acknowledgement, and a decoder whose motor adds noise and a start-up surge to the current.  Further traces captured from real decoders can be added alongside them.
+
+**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../DCCpp_Uno/AckDetector.h"
+
+struct Verify{
+  int expect;
+  int line;
+  std::vector<int> samples;
+};
+
+struct Section{
+  std::vector<int> base;
+  std::vector<Verify> verifies;
+};
+
+struct AckReplay{
+  static int nFailed;
+  static int nVerifies;
+  static bool load(const char *, std::vector<Section> &);
+  static void replay(const char *, std::vector<Section> &);
+}; // AckReplay
+
+int AckReplay::nFailed=0;
+int AckReplay::nVerifies=0;
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool AckReplay::load(const char *file, std::vector<Section> &sections){
+  FILE *f=fopen(file,"r");
+  char buf[512];
+  int line=0;
+  std::vector<int> *dest=NULL;
+
+  if(f==NULL){
+    perror(file);
+    return(false);
+  }
+
+  while(fgets(buf,sizeof(buf),f)!=NULL){
+    line++;
+    char *c=strchr(buf,'#');
+    if(c!=NULL)
+      *c='\0';
+
+    for(char *tok=strtok(buf," \t\r\n");tok!=NULL;tok=strtok(NULL," \t\r\n")){
+      if(strcmp(tok,"base")==0){
+        sections.push_back(Section());
+        dest=&sections.back().base;
+      } else if(strcmp(tok,"verify")==0){
+        char *e=strtok(NULL," \t\r\n");
+        if(sections.empty() || e==NULL || (strcmp(e,"0")!=0 && strcmp(e,"1")!=0)){
+          fprintf(stderr,"%s:%d: verify must follow a base section and be given an EXPECT of 0 or 1\n",file,line);
+          fclose(f);
+          return(false);
+        }
+        Verify v;
+        v.expect=atoi(e);
+        v.line=line;
+        sections.back().verifies.push_back(v);
+        dest=&sections.back().verifies.back().samples;
+      } else if(dest!=NULL){
+        dest->push_back(atoi(tok));
+      } else {
+        fprintf(stderr,"%s:%d: samples must follow a base or verify section\n",file,line);
+        fclose(f);
+        return(false);
+      }
+    }
+  }
+
+  fclose(f);
+  return(true);
+} // AckReplay::load
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AckReplay::replay(const char *file, std::vector<Section> &sections){
+  AckDetector ack;
+
+  printf("%s\n",file);
+
+  for(size_t i=0;i<sections.size();i++){
+    ack.begin();
+    for(size_t j=0;j<sections[i].base.size();j++)
+      ack.baseSample(sections[i].base[j]);
+
+    for(size_t j=0;j<sections[i].verifies.size();j++){
+      Verify &v=sections[i].verifies[j];
+      size_t n;
+      int d=ACK_PENDING;
+
+      ack.arm();
+      for(n=0;n<v.samples.size() && d==ACK_PENDING;n++)
+        d=ack.sample(v.samples[n]);
+      if(d==ACK_PENDING)                      // trace ended before the detector decided --- window has ended
+        d=0;
+
+      nVerifies++;
+      if(d!=v.expect)
+        nFailed++;
+
+      printf("  line %-4d base %4d  threshold %5.1f  ack %d after %3d of %3d samples  %s\n",
+             v.line,ack.base,ack.threshold,d,(int)n,(int)v.samples.size(),d==v.expect?"ok":"FAILED");
+    }
+  }
+} // AckReplay::replay
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv){
+
+  if(argc<2){
+    fprintf(stderr,"usage: AckReplay TRACE...\n");
+    return(2);
+  }
+
+  for(int i=1;i<argc;i++){
+    std::vector<Section> sections;
+    if(!AckReplay::load(argv[i],sections))
+      return(2);
+    AckReplay::replay(argv[i],sections);
+  }
+
+  printf("\n%d verifies, %d failed\n",AckReplay::nVerifies,AckReplay::nFailed);
+  return(AckReplay::nFailed>0?1:0);
+}
@@ -0,0 +1,567 @@
+/**********************************************************************
+
+FuzzParse.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+FuzzParse is a coverage-guided fuzzing harness for the command parser of DCC++ BASE STATION.  It is NOT part of the
+sketch and must not be placed in the DCCpp_Uno folder.  It compiles the sketch itself --- setup(), SerialCommand::parse(),
+and every handler behind it, including writeTextPacket(), Turnout::parse(), Sensor::parse(), and Output::parse() ---
+on a host computer against the stand-ins for the Arduino core in the host folder, and feeds it arbitrary input.
+
+Besides finding crashes, hangs, and (with the sanitizers below) memory errors and undefined behavior, FuzzParse measures
+the COST of each input as the number of basic blocks of the sketch executed while processing it.  Unlike a time, the
+cost of an input is the same on every run and every host, so it can be used to track a worst-case budget for parsing as
+the parser evolves.  The most expensive input seen for each command letter is kept, and listed when FuzzParse exits.
+
+With clang and libFuzzer, compile and run from the tools folder with:
+
+  clang++ -std=gnu++11 -g -O1 -fsanitize=fuzzer-no-link,address,undefined -fno-sanitize-recover=all -fsanitize-coverage=trace-pc -w -DARDUINO_AVR_MEGA2560 -Ihost -c -x c++ ../DCCpp_Uno/DCCpp_Uno.ino ../DCCpp_Uno/[A-Z]*.cpp
+  clang++ -std=gnu++11 -g -O1 -fsanitize=fuzzer,address,undefined -fno-sanitize-recover=all -DARDUINO_AVR_MEGA2560 -DLIBFUZZER -Ihost -o FuzzParse FuzzParse.cpp host/Core.cpp *.o
+  mkdir -p findings && ./FuzzParse -dict=FuzzParse.dict -max_len=256 findings corpus
+
+The most expensive inputs are then listed when libFuzzer stops (e.g. after -runs=N or -max_total_time=SECONDS).  Set the
+environment variable FUZZPARSE_BUDGET to a cost to have any input costing more (other than one using the programming track,
+see below) reported as a crash, which libFuzzer saves as usual, and FUZZPARSE_OUT to a folder in which to save the most
+expensive inputs.
+
+Without libFuzzer (e.g. with g++), leave out fuzzer-no-link and -DLIBFUZZER, and FuzzParse uses a simple coverage-guided
+fuzzer of its own instead:
+
+  g++ -std=gnu++11 -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all -fsanitize-coverage=trace-pc -w -DARDUINO_AVR_MEGA2560 -Ihost -c -x c++ ../DCCpp_Uno/DCCpp_Uno.ino ../DCCpp_Uno/[A-Z]*.cpp
+  g++ -std=gnu++11 -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all -DARDUINO_AVR_MEGA2560 -Ihost -o FuzzParse FuzzParse.cpp host/Core.cpp *.o
+  ./FuzzParse [-r RUNS] [-s SEED] [-x DICT] [-b BUDGET] [-o FOLDER] [-v] INPUT...
+
+where
+
+  INPUT      a file holding one input, or a folder of such files (e.g. corpus), each of which is run first
+  -r RUNS    after running every INPUT, runs RUNS more inputs, each made by randomly mutating one already run, and keeps
+             each that executes a basic block of the sketch not executed before for further mutation (default 0)
+  -s SEED    seed of the random mutations (default 1)
+  -x DICT    dictionary of tokens to insert into inputs, in the format used by libFuzzer (e.g. FuzzParse.dict)
+  -b BUDGET  reports every input costing more than BUDGET, and exits with status 1 if there were any (see below)
+  -o FOLDER  saves the most expensive inputs in FOLDER
+  -v         prints each input and the replies to it
+
+An input that puts a packet on the programming track (e.g. <R>, <J>, <W>, <B>, or <P>) is never checked against the budget,
+since its cost is dominated by sampling the current for the decoder's acknowledgement rather than by parsing: the <R> and
+<J> input in the corpus costs over 600000.  Every other input in the corpus costs less than 20000 (the most, about 16000,
+being the status and listing commands), so ./FuzzParse -b 20000 corpus checks that none has become more expensive, and
+./FuzzParse -r 200000 -x FuzzParse.dict -o worst corpus looks for more expensive ones.  Use -DARDUINO_AVR_UNO in place of
+-DARDUINO_AVR_MEGA2560 to fuzz the Uno configuration.
+
+Each input is a stream of bytes received from the serial port, so it may hold any number of text and binary commands,
+in any framing.  An input starts from the same state as every other: turnouts, sensors, outputs, routes, reflexes,
+automation handlers, the recorder log, the roster, and event subscriptions are all cleared once it has been processed.
+While the sketch waits in Scheduler::yield() (e.g. for the DCC signal to pick up a packet, or for a CV to be acknowledged),
+FuzzParse stands in for the DCC signal interrupts by running them until any packet waiting to be picked up has been,
+advancing the Clock by 128 microseconds per DCC bit.  The interrupts are not counted in the cost, and a packet that is
+never picked up is reported as a hang, as is any input costing more than FUZZ_HANG_COST.
+
+Note that int is 32 bits on the host, rather than 16 bits as on the AVR, so the host accepts numbers that the AVR would
+overflow, and the free SRAM reported by <F> is meaningless.
+
+**********************************************************************/
+
+#include "Arduino.h"
+#include "../DCCpp_Uno/DCCpp_Uno.h"
+#include "../DCCpp_Uno/PacketRegister.h"
+#include "../DCCpp_Uno/Accessories.h"
+#include "../DCCpp_Uno/Sensor.h"
+#include "../DCCpp_Uno/Outputs.h"
+#include "../DCCpp_Uno/Routes.h"
+#include "../DCCpp_Uno/Reflex.h"
+#include "../DCCpp_Uno/Automation.h"
+#include "../DCCpp_Uno/Roster.h"
+#include "../DCCpp_Uno/Recorder.h"
+#include "../DCCpp_Uno/Scheduler.h"
+#include "../DCCpp_Uno/Session.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#define  FUZZ_WORST         16                // number of most expensive inputs listed
+#define  FUZZ_HANG_COST     100000000UL       // cost after which an input is taken to hang
+#define  FUZZ_SIGNAL_BITS   100000            // DCC bits after which a packet that has not been picked up is taken never to be
+#define  FUZZ_MAX_LENGTH    256               // maximum length of a mutated input
+#define  FUZZ_MAP_SIZE      65536             // number of entries in the map of basic blocks executed
+
+extern volatile RegisterList mainRegs;        // defined in DCCpp_Uno.ino
+extern volatile RegisterList progRegs;
+void setup();
+
+extern "C" void TIMER1_COMPB_vect();
+extern "C" void TIMER2_OVF_vect();
+#ifdef ARDUINO_AVR_UNO
+  extern "C" void TIMER0_COMPB_vect();
+  #define  PROG_SIGNAL_VECT   TIMER0_COMPB_vect
+#else
+  extern "C" void TIMER3_COMPB_vect();
+  #define  PROG_SIGNAL_VECT   TIMER3_COMPB_vect
+#endif
+
+struct Worst{
+  unsigned long cost;
+  std::string input;
+};
+
+struct FuzzParse{
+  static unsigned long cost;
+  static boolean counting;
+  static boolean progTrack;
+  static byte map[FUZZ_MAP_SIZE];
+  static byte seen[FUZZ_MAP_SIZE];
+  static const std::string *input;
+  static std::map<int,Worst> worst;
+  static unsigned long budget;
+  static unsigned long nOverBudget;
+  static const char *outFolder;
+  static boolean verbose;
+  static std::vector<std::string> corpus;
+  static std::vector<std::string> dict;
+  static void begin();
+  static void signal();
+  static void hang(const char *);
+  static unsigned long run(const std::string &);
+  static void reset();
+  static void report();
+  static void print(FILE *, const std::string &);
+  static void output(uint8_t);
+  static boolean load(const char *);
+  static boolean loadDict(const char *);
+  static void mutate(std::string &);
+  static boolean newBlocks();
+}; // FuzzParse
+
+unsigned long FuzzParse::cost=0;
+boolean FuzzParse::counting=false;
+boolean FuzzParse::progTrack=false;
+byte FuzzParse::map[FUZZ_MAP_SIZE];
+byte FuzzParse::seen[FUZZ_MAP_SIZE];
+const std::string *FuzzParse::input=NULL;
+std::map<int,Worst> FuzzParse::worst;
+unsigned long FuzzParse::budget=0;
+unsigned long FuzzParse::nOverBudget=0;
+const char *FuzzParse::outFolder=NULL;
+boolean FuzzParse::verbose=false;
+std::vector<std::string> FuzzParse::corpus;
+std::vector<std::string> FuzzParse::dict;
+
+///////////////////////////////////////////////////////////////////////////////
+
+// CALLED AT THE START OF EVERY BASIC BLOCK OF THE SKETCH, WHICH IS COMPILED WITH -fsanitize-coverage=trace-pc
+
+extern "C" void __sanitizer_cov_trace_pc(){
+  uintptr_t pc;
+
+  if(!FuzzParse::counting)
+    return;
+
+  if(++FuzzParse::cost>FUZZ_HANG_COST)
+    FuzzParse::hang("input costs more than FUZZ_HANG_COST");
+
+  pc=(uintptr_t)__builtin_return_address(0);
+  FuzzParse::map[(pc^(pc>>16))%FUZZ_MAP_SIZE]=1;
+} // __sanitizer_cov_trace_pc
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::begin(){
+  if(Serial.output!=NULL)
+    return;
+
+  Serial.output=output;
+  TCNT1=0xFFFF;                               // timers always appear to have just reached the end of a bit, so no interrupt is counted as an overrun
+  TCNT3=0xFFFF;
+  TCNT0=0xFF;
+
+  setup();
+  Scheduler::add(PSTR("SIGNAL"),signal,0,0,TASK_CRITICAL);      // stands in for the DCC signal interrupts while the sketch waits
+  signal();                                   // picks up the idle packets loaded by setup(), which would otherwise be taken as loaded by the first input
+  reset();
+
+  if(getenv("FUZZPARSE_BUDGET")!=NULL)
+    budget=strtoul(getenv("FUZZPARSE_BUDGET"),NULL,10);
+  if(getenv("FUZZPARSE_OUT")!=NULL)
+    outFolder=getenv("FUZZPARSE_OUT");
+  atexit(report);
+} // FuzzParse::begin
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RUNS THE DCC SIGNAL INTERRUPTS UNTIL NEITHER TRACK HAS A PACKET WAITING TO BE PICKED UP
+
+void FuzzParse::signal(){
+  boolean c=counting;
+
+  counting=false;
+  if(progRegs.nextReg!=NULL)
+    progTrack=true;
+  TIMER2_OVF_vect();
+  for(int n=0;mainRegs.nextReg!=NULL || progRegs.nextReg!=NULL;n++){
+    if(n==FUZZ_SIGNAL_BITS)
+      hang("packet is never picked up by the DCC signal");
+    TIMER1_COMPB_vect();
+    PROG_SIGNAL_VECT();
+    TIMER2_OVF_vect();
+  }
+  counting=c;
+} // FuzzParse::signal
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::hang(const char *why){
+  counting=false;
+  fprintf(stderr,"HANG: %s\n",why);
+  if(input!=NULL){
+    fprintf(stderr,"input: ");
+    print(stderr,*input);
+    fprintf(stderr,"\n");
+  }
+  abort();
+} // FuzzParse::hang
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RUNS INPUT S AS IF RECEIVED ON THE SERIAL PORT, AND RETURNS ITS COST
+
+unsigned long FuzzParse::run(const std::string &s){
+  Session *serial=Session::session+NET_SESSIONS;
+  int key=-1;
+  size_t p;
+
+  if(verbose){
+    printf("> ");
+    print(stdout,s);
+    printf("\n< ");
+  }
+
+  memset(map,0,sizeof(map));
+  input=&s;
+  cost=0;
+  progTrack=false;
+  counting=true;
+  Session::current=serial;
+  for(size_t i=0;i<s.size();i++)
+    serial->receive(s[i]);
+  Session::current=NULL;
+  counting=false;
+
+  Session::flushAll();
+  signal();
+  reset();
+  input=NULL;
+
+  if(verbose)
+    printf("\n  cost %lu%s\n",cost,progTrack?" (programming track --- not checked against the budget)":"");
+
+  if((p=s.find('<'))!=std::string::npos && p+1<s.size())       // key is the letter of the first text command, or the start of a binary frame
+    key=(byte)s[p+1];
+  else if(s.find((char)BINARY_START)!=std::string::npos)
+    key=BINARY_START;
+  if(key>=0 && (worst.count(key)==0 || cost>worst[key].cost)){
+    worst[key].cost=cost;
+    worst[key].input=s;
+  }
+
+  if(budget>0 && cost>budget && !progTrack){
+    nOverBudget++;
+    fprintf(stderr,"OVER BUDGET: cost %lu: ",cost);
+    print(stderr,s);
+    fprintf(stderr,"\n");
+    #ifdef LIBFUZZER
+      abort();                                // libFuzzer saves input as a crash
+    #endif
+  }
+
+  return(cost);
+} // FuzzParse::run
+
+///////////////////////////////////////////////////////////////////////////////
+
+// CLEARS EVERYTHING AN INPUT MAY HAVE DEFINED, SO THAT THE NEXT INPUT STARTS FROM THE SAME STATE
+
+void FuzzParse::reset(){
+  boolean v=verbose;
+
+  verbose=false;                              // replies to removing each definition are not of interest
+  while(Turnout::firstTurnout!=NULL)
+    Turnout::remove(Turnout::firstTurnout->data.id);
+  while(Sensor::firstSensor!=NULL)
+    Sensor::remove(Sensor::firstSensor->data.snum);
+  while(Output::firstOutput!=NULL)
+    Output::remove(Output::firstOutput->data.id);
+  while(Route::firstRoute!=NULL)
+    Route::remove(Route::firstRoute->data.id);
+  while(Reflex::firstReflex!=NULL)
+    Reflex::remove(Reflex::firstReflex->data.snum);
+
+  free(Automation::program);
+  Automation::program=NULL;
+  Automation::size=0;
+  memset(Automation::timer,0,sizeof(Automation::timer));
+
+  Recorder::mode=RECORDER_IDLE;
+  Recorder::nBytes=0;
+
+  memset(Roster::roster,0,sizeof(Roster::roster));
+  Roster::useCount=0;
+
+  Session::flushAll();
+  Session::session[NET_SESSIONS].open(SESSION_SERIAL);     // also discards any partial command, and event subscriptions
+  verbose=v;
+} // FuzzParse::reset
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::report(){
+  std::vector<std::pair<unsigned long,int> > w;
+  char name[512];
+
+  fflush(stdout);
+  for(std::map<int,Worst>::iterator i=worst.begin();i!=worst.end();i++)
+    w.push_back(std::make_pair(i->second.cost,i->first));
+  std::sort(w.rbegin(),w.rend());
+
+  fprintf(stderr,"\nmost expensive input for each command (cost = basic blocks of the sketch executed):\n\n");
+  for(size_t i=0;i<w.size() && i<FUZZ_WORST;i++){
+    Worst &x=worst[w[i].second];
+    fprintf(stderr,"  %9lu  ",x.cost);
+    print(stderr,x.input.substr(0,100));
+    fprintf(stderr,"%s\n",x.input.size()>100?"...":"");
+    if(outFolder!=NULL){
+      snprintf(name,sizeof(name),"%s/worst-%02X",outFolder,w[i].second);
+      FILE *f=fopen(name,"wb");
+      if(f==NULL){
+        perror(name);
+        continue;
+      }
+      fwrite(x.input.data(),1,x.input.size(),f);
+      fclose(f);
+    }
+  }
+} // FuzzParse::report
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::print(FILE *f, const std::string &s){
+  for(size_t i=0;i<s.size();i++){
+    if(isprint((byte)s[i]) && s[i]!='\\')
+      fputc(s[i],f);
+    else
+      fprintf(f,"\\x%02X",(byte)s[i]);
+  }
+} // FuzzParse::print
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::output(uint8_t c){
+  if(verbose)
+    putchar(c);
+} // FuzzParse::output
+
+///////////////////////////////////////////////////////////////////////////////
+
+// ADDS THE INPUT IN FILE, OR EVERY INPUT IN FOLDER FILE, TO THE CORPUS
+
+boolean FuzzParse::load(const char *file){
+  DIR *d=opendir(file);
+  FILE *f;
+  std::string s;
+  char buf[512];
+  size_t n;
+
+  if(d!=NULL){
+    std::vector<std::string> names;
+    for(struct dirent *e=readdir(d);e!=NULL;e=readdir(d))
+      if(e->d_name[0]!='.')
+        names.push_back(std::string(file)+"/"+e->d_name);
+    closedir(d);
+    std::sort(names.begin(),names.end());
+    for(size_t i=0;i<names.size();i++)
+      if(!load(names[i].c_str()))
+        return(false);
+    return(true);
+  }
+
+  if((f=fopen(file,"rb"))==NULL){
+    perror(file);
+    return(false);
+  }
+  while((n=fread(buf,1,sizeof(buf),f))>0)
+    s.append(buf,n);
+  fclose(f);
+  corpus.push_back(s);
+  return(true);
+} // FuzzParse::load
+
+///////////////////////////////////////////////////////////////////////////////
+
+// READS A DICTIONARY OF "TOKEN" LINES, WITH \\, \", AND \xHH ESCAPES, AS USED BY LIBFUZZER
+
+boolean FuzzParse::loadDict(const char *file){
+  FILE *f=fopen(file,"r");
+  char buf[512], *c;
+  int line=0;
+
+  if(f==NULL){
+    perror(file);
+    return(false);
+  }
+
+  while(fgets(buf,sizeof(buf),f)!=NULL){
+    std::string s;
+    line++;
+    for(c=buf;isspace(*c);c++);
+    if(*c=='#' || *c=='\0')
+      continue;
+    if((c=strchr(c,'"'))==NULL){
+      fprintf(stderr,"%s:%d: token must be in quotes\n",file,line);
+      fclose(f);
+      return(false);
+    }
+    for(c++;*c!='"' && *c!='\0';c++){
+      if(*c=='\\' && c[1]=='x' && isxdigit(c[2]) && isxdigit(c[3])){
+        s+=(char)strtol(std::string(c+2,2).c_str(),NULL,16);
+        c+=3;
+      } else if(*c=='\\' && c[1]!='\0'){
+        s+=*++c;
+      } else {
+        s+=*c;
+      }
+    }
+    dict.push_back(s);
+  }
+
+  fclose(f);
+  return(true);
+} // FuzzParse::loadDict
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FuzzParse::mutate(std::string &s){
+  int n=1+rand()%4;
+
+  while(n-->0){
+    size_t p=rand()%(s.size()+1);
+    switch(rand()%6){
+      case 0:                                 // flip a bit
+        if(!s.empty())
+          s[p%s.size()]^=1<<(rand()%8);
+        break;
+      case 1:                                 // insert a random byte
+        s.insert(p,1,(char)(rand()%256));
+        break;
+      case 2:                                 // insert a token from the dictionary
+        if(!dict.empty())
+          s.insert(p,dict[rand()%dict.size()]);
+        break;
+      case 3:                                 // delete up to 8 bytes
+        if(!s.empty())
+          s.erase(p%s.size(),1+rand()%8);
+        break;
+      case 4:                                 // copy up to 16 bytes to elsewhere in the input
+        if(!s.empty())
+          s.insert(p,s.substr(rand()%s.size(),1+rand()%16));
+        break;
+      case 5:{                                // splice in the tail of another input
+        const std::string &o=corpus[rand()%corpus.size()];
+        s.insert(p,o.substr(rand()%(o.size()+1)));
+        break;
+      }
+    }
+  }
+
+  if(s.size()>FUZZ_MAX_LENGTH)
+    s.resize(FUZZ_MAX_LENGTH);
+} // FuzzParse::mutate
+
+///////////////////////////////////////////////////////////////////////////////
+
+// RETURNS TRUE IF THE LAST INPUT RUN EXECUTED ANY BASIC BLOCK NOT EXECUTED BY AN EARLIER ONE
+
+boolean FuzzParse::newBlocks(){
+  boolean found=false;
+
+  for(int i=0;i<FUZZ_MAP_SIZE;i++){
+    if(map[i] && !seen[i]){
+      seen[i]=1;
+      found=true;
+    }
+  }
+  return(found);
+} // FuzzParse::newBlocks
+
+///////////////////////////////////////////////////////////////////////////////
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size){
+  FuzzParse::begin();
+  FuzzParse::run(std::string((const char *)data,size));
+  return(0);
+} // LLVMFuzzerTestOneInput
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef LIBFUZZER
+
+static void usage(){
+  fprintf(stderr,"usage: FuzzParse [-r RUNS] [-s SEED] [-x DICT] [-b BUDGET] [-o FOLDER] [-v] INPUT...\n");
+  exit(2);
+} // usage
+
+int main(int argc, char **argv){
+  unsigned long runs=0, nKept=0;
+  unsigned int seed=1;
+  size_t nInputs;
+  int opt;
+
+  while((opt=getopt(argc,argv,"r:s:x:b:o:v"))!=-1){
+    switch(opt){
+      case 'r': runs=strtoul(optarg,NULL,10); break;
+      case 's': seed=strtoul(optarg,NULL,10); break;
+      case 'x': if(!FuzzParse::loadDict(optarg)) return(2); break;
+      case 'b': setenv("FUZZPARSE_BUDGET",optarg,1); break;
+      case 'o': setenv("FUZZPARSE_OUT",optarg,1); break;
+      case 'v': FuzzParse::verbose=true; break;
+      default: usage();
+    }
+  }
+
+  for(int i=optind;i<argc;i++)
+    if(!FuzzParse::load(argv[i]))
+      return(2);
+  if(FuzzParse::corpus.empty())
+    usage();
+
+  FuzzParse::begin();
+  srand(seed);
+
+  nInputs=FuzzParse::corpus.size();
+  for(size_t i=0;i<nInputs;i++){
+    FuzzParse::run(FuzzParse::corpus[i]);
+    FuzzParse::newBlocks();
+  }
+
+  for(unsigned long i=0;i<runs;i++){
+    std::string s=FuzzParse::corpus[rand()%FuzzParse::corpus.size()];
+    FuzzParse::mutate(s);
+    FuzzParse::run(s);
+    if(FuzzParse::newBlocks()){
+      FuzzParse::corpus.push_back(s);
+      nKept++;
+    }
+  }
+
+  fprintf(stderr,"%lu inputs run, %lu mutated inputs kept for new coverage, %lu over budget\n",
+          (unsigned long)nInputs+runs,nKept,FuzzParse::nOverBudget);
+  return(FuzzParse::nOverBudget>0?1:0);
+}
+
+#endif
@@ -0,0 +1,853 @@
+/**********************************************************************
+
+LoadGen.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+LoadGen is a host-side load generator and latency benchmark for DCC++ BASE STATION.  It is NOT part of the
+sketch and must not be placed in the DCCpp_Uno folder.  It runs on any POSIX host (Linux, macOS) and is compiled with:
+
+  g++ -std=c++11 -O2 -o LoadGen LoadGen.cpp
+
+LoadGen connects to a Base Station either through a serial device or pseudo-terminal (a real board on /dev/ttyACM0,
+or a simulated build such as simavr whose UART is exposed as a pty), or through TCP to a Mega with an Ethernet Shield.
+It then plays the part of many virtual throttles, each sending a configurable mix of commands at a target rate,
+matches every reply to the request that caused it, and reports throughput and latency for each type of command.
+
+  LoadGen -p DEVICE [-b BAUD] [options]
+  LoadGen -n HOST:PORT [-c CONNECTIONS] [options]
+
+where the options are
+
+  -p DEVICE       serial device or pty of the Base Station
+  -b BAUD         baud rate of DEVICE (default 115200)
+  -n HOST:PORT    address of a Base Station with an Ethernet Shield
+  -c CONNECTIONS  number of TCP connections (i.e. Base Station sessions) to spread the throttles over (default 1)
+  -t THROTTLES    number of virtual throttles (default 8)
+  -r RATE         total commands per second sent by all throttles together (default 50)
+  -d SECONDS      duration of the run (default 10)
+  -m MIX          relative weights of each type of command (default t=60,f=20,a=5,T=5,R=0,s=10)
+  -w WINDOW       maximum number of requests awaiting a reply on each connection (default 4)
+  -T IDS          comma-separated list of turnout IDs to throw with <T> (default 1)
+  -R REGISTERS    number of main track registers used by the throttles (default 12)
+  -s MS           gap in replies, or time blocked writing, that counts as a STALL (default 20)
+  -x MS           time after which a request is considered lost (default 5000)
+  -W MS           time to wait after connecting before starting, e.g. while the Arduino resets (default 2000 for DEVICE, 0 for TCP)
+  -i              after the run, print the Base Station's own counters <G>, schedule <K>, and histograms <l>
+  -z              instead of the mix above, FUZZ the command parser for the duration of the run (see below)
+  -j CVS          instead of the mix above, time decoder IDENTIFICATION on the programming track, reading the comma-separated
+                  list of CVS as well (see below)
+
+Each virtual throttle N uses main track register (N % REGISTERS)+1 and cab N+3, and sends:
+
+  t: <t REGISTER CAB SPEED DIRECTION> with a random speed and direction                  matched to <T ...>
+  f: <f CAB BYTE1> with random function settings                                       matched to <f MEM> of a following <F>
+  a: <a ADDRESS SUBADDRESS ACTIVATE> with a random accessory address                   matched to <f MEM> of a following <F>
+  T: <T ID THROW> with a turnout ID chosen from the -T list                            matched to <H ...> or <X>
+  R: <R 1 N SEQ> reading CV 1 on the programming track                                 matched to <r ...>
+  s: <s>                                                                               matched to <f MEM> of a following <F>
+
+Commands that produce no reply of their own (f and a), or a variable number of replies (s), are followed by a <F>
+whose single <f MEM> reply marks the point at which the Base Station has finished with the request.  Replies
+to each connection arrive in the order the requests were made, so any other frame (e.g. <Q ID> from a sensor,
+or the <T> and <H> lines of a <s> status report) is skipped while waiting for the oldest request's reply.
+
+LATENCY is measured from the time a request was SCHEDULED to be sent, not when it was actually sent, so a
+Base Station that falls behind is charged for the time requests spent waiting for the WINDOW to open.
+A STALL is recorded whenever requests are outstanding but no reply byte arrives for longer than the -s time
+(excluding <R>, which legitimately takes hundreds of milliseconds), or when writing to the Base Station blocks
+for longer than the -s time.  Stalls are the host-side view of the Base Station waiting in loadPacket() for
+the DCC signal interrupt, or blocking in INTERFACE.print() on a full transmit buffer; use -i to compare against
+the WAIT histogram and the counters the Base Station keeps itself.
+
+With -z, LoadGen instead sends one randomly-generated, usually malformed, command at a time: a command letter
+followed by a random number of random tokens (boundary integers, hexidecimal bytes, batch separators, stray
+characters, and occasionally very long arguments).  Each is followed by a <F> whose <f MEM> reply shows that
+the Base Station survived the command and is still responding.  A command with no such reply within the -x time
+is reported as a HANG.  At the end of the run the slowest commands seen from the host are listed, followed by the
+Base Station's own list of its most expensive commands from <y> (see ParseCost.cpp).  Since fuzzing creates sensors
+and outputs on random pins, and writes CVs on both tracks, only fuzz a simulated build or a board with nothing
+connected to its pins or tracks.  <D>, <E>, <e>, and <F> are never sent.
+
+With -j, LoadGen times identifying the decoder on the programming track and reading the listed CVs, first one CV at a
+time with <R> (CV8, CV7, CV29, then CV1 or CV17 and CV18 depending on CV29, then each of CVS), exactly as a host had to
+before batch reads were available, and then twice with a single <J> batch (see SerialCommand.cpp and Roster.cpp): the
+first <J> re-reads every CV, and the second finds the decoder in the roster and only verifies the identifying CVs.  The
+time of every read, as seen from the host, is printed, followed by the TIME reported in each <j> reply.  Running the
+same -j test against a build from before batch reads and adaptive ACK detection (on which <J> is reported as not
+supported) gives the baseline.
+
+**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#define  LOADGEN_TYPES        "tfaTRs"
+#define  LOADGEN_NTYPES       6
+#define  LOADGEN_MAX_FRAME    256       // longest reply frame kept while waiting for its closing '>'
+#define  LOADGEN_FUZZ_LETTERS "tfaTZAVUSQwbWBRJcsKGl*@MPL%+y01 xjk"
+#define  LOADGEN_FUZZ_SLOWEST 8         // number of slowest fuzz commands listed
+
+struct Request{
+  int type;                             // index into LOADGEN_TYPES
+  double scheduled;                     // seconds
+  double sent;
+  const char *expect;                   // first character(s) after '<' of the reply that completes this request
+};
+
+struct Conn{
+  int fd;
+  std::string rx;
+  std::string tx;
+  std::deque<Request> pending;
+  double lastRx;
+  double writeBlocked;                  // time writing first blocked, or 0 if not blocked
+};
+
+struct Throttle{
+  int nReg;
+  int cab;
+  int conn;
+  double next;                          // time at which next request is scheduled
+  bool blocked;                         // next request is overdue because the WINDOW of its connection is full
+};
+
+struct Stats{
+  long sent;
+  long replied;
+  long errors;                          // replies of <X>
+  long lost;
+  std::vector<double> latency;          // milliseconds
+};
+
+struct LoadGen{
+  static std::vector<Conn> conn;
+  static std::vector<Throttle> throttle;
+  static Stats stats[LOADGEN_NTYPES];
+  static int weight[LOADGEN_NTYPES];
+  static int totalWeight;
+  static std::vector<int> turnouts;
+  static long nStalls;
+  static double stallTime, maxStall;
+  static long nWriteStalls;
+  static double writeStallTime, maxWriteStall;
+  static long nWindowFull;
+  static double now();
+  static int openSerial(const char *, int);
+  static int openTCP(const char *);
+  static void setMix(const char *);
+  static int pickType();
+  static void send(Throttle &, double);
+  static void flush(Conn &, double);
+  static void receive(Conn &, double);
+  static void frame(Conn &, const std::string &, double);
+  static void expire(Conn &, double, double);
+  static void query(const char *, double);
+  static void report(double);
+  static std::string fuzzCommand();
+  static void fuzz(double, double);
+  static std::string transact(Conn &, const std::string &, const char *, double, double &);
+  static void identify(const char *, double);
+}; // LoadGen
+
+std::vector<Conn> LoadGen::conn;
+std::vector<Throttle> LoadGen::throttle;
+Stats LoadGen::stats[LOADGEN_NTYPES];
+int LoadGen::weight[LOADGEN_NTYPES]={60,20,5,5,0,10};
+int LoadGen::totalWeight=100;
+std::vector<int> LoadGen::turnouts(1,1);
+long LoadGen::nStalls=0;
+double LoadGen::stallTime=0;
+double LoadGen::maxStall=0;
+long LoadGen::nWriteStalls=0;
+double LoadGen::writeStallTime=0;
+double LoadGen::maxWriteStall=0;
+long LoadGen::nWindowFull=0;
+
+static double stallLimit=0.020;
+
+///////////////////////////////////////////////////////////////////////////////
+
+double LoadGen::now(){
+  struct timeval tv;
+  gettimeofday(&tv,NULL);
+  return(tv.tv_sec+tv.tv_usec/1e6);
+} // LoadGen::now
+
+///////////////////////////////////////////////////////////////////////////////
+
+int LoadGen::openSerial(const char *device, int baud){
+  struct termios tio;
+  speed_t speed;
+  int fd;
+
+  switch(baud){
+    case 9600: speed=B9600; break;
+    case 19200: speed=B19200; break;
+    case 38400: speed=B38400; break;
+    case 57600: speed=B57600; break;
+    case 115200: speed=B115200; break;
+    default:
+      fprintf(stderr,"LoadGen: unsupported baud rate %d\n",baud);
+      return(-1);
+  }
+
+  if((fd=open(device,O_RDWR|O_NOCTTY|O_NONBLOCK))<0){
+    perror(device);
+    return(-1);
+  }
+
+  if(tcgetattr(fd,&tio)==0){            // a pty from a simulator may not support every setting, so failures here are not fatal
+    cfmakeraw(&tio);
+    cfsetispeed(&tio,speed);
+    cfsetospeed(&tio,speed);
+    tio.c_cflag|=CLOCAL|CREAD;
+    tio.c_cflag&=~CRTSCTS;
+    tcsetattr(fd,TCSANOW,&tio);
+    tcflush(fd,TCIOFLUSH);
+  }
+
+  return(fd);
+} // LoadGen::openSerial
+
+///////////////////////////////////////////////////////////////////////////////
+
+int LoadGen::openTCP(const char *address){
+  struct addrinfo hints, *res, *r;
+  std::string host(address);
+  size_t colon=host.rfind(':');
+  int fd=-1, one=1;
+
+  if(colon==std::string::npos){
+    fprintf(stderr,"LoadGen: expected HOST:PORT, got %s\n",address);
+    return(-1);
+  }
+
+  memset(&hints,0,sizeof(hints));
+  hints.ai_family=AF_UNSPEC;
+  hints.ai_socktype=SOCK_STREAM;
+  if(getaddrinfo(host.substr(0,colon).c_str(),host.substr(colon+1).c_str(),&hints,&res)!=0){
+    fprintf(stderr,"LoadGen: cannot resolve %s\n",address);
+    return(-1);
+  }
+
+  for(r=res;r!=NULL;r=r->ai_next){
+    if((fd=socket(r->ai_family,r->ai_socktype,r->ai_protocol))<0)
+      continue;
+    if(connect(fd,r->ai_addr,r->ai_addrlen)==0)
+      break;
+    close(fd);
+    fd=-1;
+  }
+  freeaddrinfo(res);
+
+  if(fd<0){
+    perror(address);
+    return(-1);
+  }
+
+  setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));      // send each command as soon as it is written
+  fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+  return(fd);
+} // LoadGen::openTCP
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::setMix(const char *mix){
+  char type;
+  int w, n;
+
+  for(int i=0;i<LOADGEN_NTYPES;i++)
+    weight[i]=0;
+
+  while(sscanf(mix," %c=%d%n",&type,&w,&n)==2){
+    const char *p=strchr(LOADGEN_TYPES,type);
+    if(p==NULL || w<0){
+      fprintf(stderr,"LoadGen: invalid mix entry %c=%d\n",type,w);
+      exit(1);
+    }
+    weight[p-LOADGEN_TYPES]=w;
+    mix+=n;
+    if(*mix==',')
+      mix++;
+  }
+
+  totalWeight=0;
+  for(int i=0;i<LOADGEN_NTYPES;i++)
+    totalWeight+=weight[i];
+
+  if(totalWeight==0){
+    fprintf(stderr,"LoadGen: mix must include at least one command\n");
+    exit(1);
+  }
+} // LoadGen::setMix
+
+///////////////////////////////////////////////////////////////////////////////
+
+int LoadGen::pickType(){
+  int r=rand()%totalWeight;
+  int i;
+
+  for(i=0;r>=weight[i];i++)
+    r-=weight[i];
+  return(i);
+} // LoadGen::pickType
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::send(Throttle &th, double t){
+  Conn &c=conn[th.conn];
+  Request req;
+  char cmd[64];
+
+  req.type=pickType();
+  req.scheduled=th.next;
+  req.sent=t;
+
+  switch(LOADGEN_TYPES[req.type]){
+    case 't':
+      snprintf(cmd,sizeof(cmd),"<t %d %d %d %d>",th.nReg,th.cab,rand()%127,rand()%2);
+      req.expect="T";
+      break;
+    case 'f':
+      snprintf(cmd,sizeof(cmd),"<f %d %d><F>",th.cab,128+rand()%32);
+      req.expect="f";
+      break;
+    case 'a':
+      snprintf(cmd,sizeof(cmd),"<a %d %d %d><F>",1+rand()%511,rand()%4,rand()%2);
+      req.expect="f";
+      break;
+    case 'T':
+      snprintf(cmd,sizeof(cmd),"<T %d %d>",turnouts[rand()%turnouts.size()],rand()%2);
+      req.expect="HX";
+      break;
+    case 'R':
+      snprintf(cmd,sizeof(cmd),"<R 1 %d %ld>",th.cab,stats[req.type].sent);
+      req.expect="r";
+      break;
+    default:
+      snprintf(cmd,sizeof(cmd),"<s><F>");
+      req.expect="f";
+      break;
+  }
+
+  c.tx+=cmd;
+  c.pending.push_back(req);
+  stats[req.type].sent++;
+} // LoadGen::send
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::flush(Conn &c, double t){
+  ssize_t n;
+
+  while(!c.tx.empty()){
+    n=write(c.fd,c.tx.data(),c.tx.size());
+    if(n<0 && (errno==EAGAIN || errno==EWOULDBLOCK)){
+      if(c.writeBlocked==0)
+        c.writeBlocked=t;
+      return;
+    }
+    if(n<0){
+      perror("LoadGen: write");
+      exit(1);
+    }
+    c.tx.erase(0,n);
+  }
+
+  if(c.writeBlocked>0){                 // writing had blocked but has now completed
+    double d=t-c.writeBlocked;
+    if(d>stallLimit){
+      nWriteStalls++;
+      writeStallTime+=d;
+      maxWriteStall=std::max(maxWriteStall,d);
+    }
+    c.writeBlocked=0;
+  }
+} // LoadGen::flush
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::receive(Conn &c, double t){
+  char buf[512];
+  ssize_t n;
+
+  while((n=read(c.fd,buf,sizeof(buf)))>0){
+
+    if(!c.pending.empty() && LOADGEN_TYPES[c.pending.front().type]!='R'){      // check for a gap in replies while requests were outstanding
+      double d=t-std::max(c.lastRx,c.pending.front().sent);
+      if(d>stallLimit){
+        nStalls++;
+        stallTime+=d;
+        maxStall=std::max(maxStall,d);
+      }
+    }
+    c.lastRx=t;
+
+    for(ssize_t i=0;i<n;i++){
+      if(buf[i]=='<')
+        c.rx.clear();
+      if(c.rx.size()<LOADGEN_MAX_FRAME)
+        c.rx+=buf[i];
+      if(buf[i]=='>' && c.rx[0]=='<'){
+        frame(c,c.rx,t);
+        c.rx.clear();
+      }
+    }
+  }
+
+  if(n==0){
+    fprintf(stderr,"LoadGen: connection closed by Base Station\n");
+    exit(1);
+  }
+} // LoadGen::receive
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::frame(Conn &c, const std::string &f, double t){
+  if(c.pending.empty() || f.size()<2 || strchr(c.pending.front().expect,f[1])==NULL)
+    return;                                                           // not the reply to the oldest request --- ignore
+
+  Request &req=c.pending.front();
+  Stats &s=stats[req.type];
+
+  s.replied++;
+  if(f[1]=='X')
+    s.errors++;
+  s.latency.push_back((t-req.scheduled)*1000.0);
+  c.pending.pop_front();
+} // LoadGen::frame
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::expire(Conn &c, double t, double timeout){
+  while(!c.pending.empty() && t-c.pending.front().sent>timeout){
+    stats[c.pending.front().type].lost++;
+    c.pending.pop_front();
+  }
+} // LoadGen::expire
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::query(const char *cmd, double wait){       // sends cmd on first connection and echoes every reply frame received within wait seconds
+  Conn &c=conn[0];
+  double end;
+  char buf[512];
+  ssize_t n;
+
+  c.tx=cmd;
+  c.rx.clear();
+  end=now()+wait;
+  while(now()<end){
+    flush(c,now());
+    struct pollfd p={c.fd,POLLIN,0};
+    poll(&p,1,10);
+    while((n=read(c.fd,buf,sizeof(buf)))>0)
+      fwrite(buf,1,n,stdout);
+  }
+  printf("\n");
+} // LoadGen::query
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::report(double elapsed){
+  long totalSent=0, totalReplied=0, totalLost=0;
+
+  printf("\n%-4s %8s %8s %6s %6s %10s %10s %10s\n","CMD","SENT","REPLIED","ERR","LOST","P50 ms","P99 ms","MAX ms");
+
+  for(int i=0;i<LOADGEN_NTYPES;i++){
+    Stats &s=stats[i];
+    if(s.sent==0)
+      continue;
+    totalSent+=s.sent;
+    totalReplied+=s.replied;
+    totalLost+=s.lost;
+    std::sort(s.latency.begin(),s.latency.end());
+    if(s.latency.empty()){
+      printf("%-4c %8ld %8ld %6ld %6ld %10s %10s %10s\n",LOADGEN_TYPES[i],s.sent,s.replied,s.errors,s.lost,"-","-","-");
+    } else {
+      size_t n=s.latency.size();
+      printf("%-4c %8ld %8ld %6ld %6ld %10.2f %10.2f %10.2f\n",LOADGEN_TYPES[i],s.sent,s.replied,s.errors,s.lost,
+        s.latency[n/2],s.latency[std::min(n-1,(size_t)(n*0.99))],s.latency[n-1]);
+    }
+  }
+
+  printf("\nTHROUGHPUT:    %.1f requests/s sent, %.1f replies/s received over %.1f s\n",totalSent/elapsed,totalReplied/elapsed,elapsed);
+  printf("LOST:          %ld requests with no reply\n",totalLost);
+  printf("REPLY STALLS:  %ld totalling %.1f ms, longest %.1f ms\n",nStalls,stallTime*1000.0,maxStall*1000.0);
+  printf("WRITE STALLS:  %ld totalling %.1f ms, longest %.1f ms\n",nWriteStalls,writeStallTime*1000.0,maxWriteStall*1000.0);
+  printf("WINDOW FULL:   %ld requests delayed waiting for earlier replies\n",nWindowFull);
+} // LoadGen::report
+
+///////////////////////////////////////////////////////////////////////////////
+
+std::string LoadGen::fuzzCommand(){
+  static const char *tokens[]={"-32768","-1","0","1","2","3","4","5","8","126","127","128","255","256","511","512",
+                               "1023","1024","1025","10293","10294","32767","65535","99999999","FF","100","1FF","x","|","||",
+                               "-","+","%","%d","%s","\\","#","0x7F","1e9"," "};
+  std::string cmd(1,LOADGEN_FUZZ_LETTERS[rand()%strlen(LOADGEN_FUZZ_LETTERS)]);
+  int nTokens=rand()%9;
+
+  for(int i=0;i<nTokens;i++){
+    if(rand()%4!=0)
+      cmd+=' ';
+    switch(rand()%8){
+      case 0:                           // random number
+        cmd+=std::to_string(rand()%70000-35000);
+        break;
+      case 1:                           // random printable characters, excluding those that frame commands
+        for(int n=rand()%6+1;n>0;n--){
+          char c=' '+rand()%95;
+          if(c!='<' && c!='>')
+            cmd+=c;
+        }
+        break;
+      case 2:                           // occasionally a very long argument, to reach past the end of the command buffer
+        if(rand()%16==0)
+          cmd+=std::string(rand()%160,'0'+rand()%10);
+        break;
+      default:                          // boundary value or separator
+        cmd+=tokens[rand()%(sizeof(tokens)/sizeof(tokens[0]))];
+        break;
+    }
+  }
+
+  return(cmd);
+} // LoadGen::fuzzCommand
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::fuzz(double duration, double timeout){
+  Conn &c=conn[0];
+  std::vector<std::pair<double,std::string> > slowest;
+  long nSent=0, nHangs=0;
+  double end=now()+duration;
+
+  printf("LoadGen: fuzzing for %.1f s\n",duration);
+
+  while(now()<end){
+    std::string cmd=fuzzCommand();
+    double t0=now(), t;
+    bool replied=false;
+
+    c.tx+="<"+cmd+"><F>";
+    c.rx.clear();
+    nSent++;
+
+    for(t=t0;t-t0<timeout && !replied;t=now()){
+      char buf[512];
+      ssize_t n;
+      struct pollfd p={c.fd,(short)(POLLIN|(c.tx.empty()?0:POLLOUT)),0};
+
+      flush(c,t);
+      poll(&p,1,10);
+      while(!replied && (n=read(c.fd,buf,sizeof(buf)))>0){
+        for(ssize_t i=0;i<n && !replied;i++){
+          if(buf[i]=='<')
+            c.rx.clear();
+          if(c.rx.size()<LOADGEN_MAX_FRAME)
+            c.rx+=buf[i];
+          replied=(buf[i]=='>' && c.rx.compare(0,2,"<f")==0);
+        }
+      }
+      if(n==0){
+        printf("CONNECTION CLOSED after <%s>\n",cmd.c_str());
+        return;
+      }
+    }
+
+    if(!replied){
+      nHangs++;
+      printf("HANG: no reply within %.0f ms after <%s>\n",timeout*1000.0,cmd.c_str());
+      c.tx.clear();
+      continue;
+    }
+
+    slowest.push_back(std::make_pair((t-t0)*1000.0,cmd));
+    std::sort(slowest.rbegin(),slowest.rend());
+    if(slowest.size()>LOADGEN_FUZZ_SLOWEST)
+      slowest.pop_back();
+  }
+
+  usleep(200000);                       // discard any replies still arriving
+  for(char buf[512];read(c.fd,buf,sizeof(buf))>0;);
+
+  printf("\nFUZZED:        %ld commands, %ld hangs\n",nSent,nHangs);
+  printf("SLOWEST (ms, including <F> and round trip):\n");
+  for(size_t i=0;i<slowest.size();i++)
+    printf("  %10.2f  <%s>\n",slowest[i].first,slowest[i].second.c_str());
+  printf("BASE STATION MOST EXPENSIVE COMMANDS:\n");
+  query("<y>",0.5);
+} // LoadGen::fuzz
+
+///////////////////////////////////////////////////////////////////////////////
+
+// SENDS CMD AND WAITS FOR THE FIRST FRAME STARTING WITH EXPECT, WHICH IS RETURNED (EMPTY IF NONE WITHIN TIMEOUT) ALONG WITH THE TIME TAKEN IN MS
+
+std::string LoadGen::transact(Conn &c, const std::string &cmd, const char *expect, double timeout, double &ms){
+  double t0=now(), t;
+  std::string f;
+
+  c.tx+=cmd;
+  c.rx.clear();
+
+  for(t=t0;t-t0<timeout;t=now()){
+    char buf[512];
+    ssize_t n;
+    struct pollfd p={c.fd,(short)(POLLIN|(c.tx.empty()?0:POLLOUT)),0};
+
+    flush(c,t);
+    poll(&p,1,10);
+    while((n=read(c.fd,buf,sizeof(buf)))>0){
+      for(ssize_t i=0;i<n;i++){
+        if(buf[i]=='<')
+          c.rx.clear();
+        if(c.rx.size()<LOADGEN_MAX_FRAME)
+          c.rx+=buf[i];
+        if(buf[i]=='>' && c.rx.compare(1,strlen(expect),expect)==0){
+          ms=(now()-t0)*1000.0;
+          return(c.rx);
+        }
+      }
+    }
+  }
+
+  ms=timeout*1000.0;
+  c.tx.clear();
+  return(f);
+} // LoadGen::transact
+
+///////////////////////////////////////////////////////////////////////////////
+
+void LoadGen::identify(const char *cvs, double timeout){
+  Conn &c=conn[0];
+  std::vector<int> cv;
+  std::string r, batch="<J 1 1";
+  double ms, total=0;
+  int cv29=-1, seq=0;
+
+  for(const char *p=cvs;*p!='\0';p+=strcspn(p,","),p+=(*p==',')){
+    cv.push_back(atoi(p));
+    batch+=" "+std::to_string(cv.back());
+  }
+  batch+=">";
+
+  std::vector<int> order={8,7,29};
+
+  printf("LoadGen: identifying decoder and reading %d CV(s)\n\nONE CV AT A TIME:\n",(int)cv.size());
+
+  for(size_t i=0;i<order.size();i++){
+    std::string cmd="<R "+std::to_string(order[i])+" 1 "+std::to_string(++seq)+">";
+    r=transact(c,cmd,"r",timeout,ms);
+    total+=ms;
+    printf("  %-16s %10.1f ms  %s\n",cmd.c_str(),ms,r.empty()?"NO REPLY":r.c_str());
+    if(order[i]==29){
+      if(!r.empty())
+        cv29=atoi(r.c_str()+r.rfind(' ')+1);
+      if(cv29>=0 && (cv29&0x20)){
+        order.push_back(17);
+        order.push_back(18);
+      } else {
+        order.push_back(1);
+      }
+      order.insert(order.end(),cv.begin(),cv.end());
+    }
+  }
+  printf("  TOTAL            %10.1f ms\n",total);
+
+  for(int pass=0;pass<2;pass++){
+    printf("\n%s <J> BATCH:\n",pass==0?"FIRST":"REPEATED");
+    r=transact(c,batch,"j",timeout,ms);
+    if(r.empty()){
+      printf("  not supported (no <j> reply within %.0f ms)\n",timeout*1000.0);
+      return;
+    }
+    printf("  %10.1f ms  %s\n  TIME reported by Base Station: %s ms\n",ms,r.c_str(),r.substr(r.rfind(' ')+1,r.size()-r.rfind(' ')-2).c_str());
+  }
+} // LoadGen::identify
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void usage(){
+  fprintf(stderr,"usage: LoadGen -p DEVICE [-b BAUD] | -n HOST:PORT [-c CONNECTIONS]\n"
+                 "               [-t THROTTLES] [-r RATE] [-d SECONDS] [-m MIX] [-w WINDOW] [-T IDS] [-R REGISTERS]\n"
+                 "               [-s STALL_MS] [-x TIMEOUT_MS] [-W WAIT_MS] [-i] [-z | -j CVS]\n");
+  exit(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv){
+  const char *device=NULL, *address=NULL, *cvs=NULL;
+  int baud=115200, nConn=1, nThrottles=8, window=4, nRegs=12, opt;
+  double rate=50, duration=10, timeout=5.0, wait=-1;
+  bool instrument=false, fuzz=false;
+  double start, end, t;
+
+  while((opt=getopt(argc,argv,"p:b:n:c:t:r:d:m:w:T:R:s:x:W:izj:"))!=-1){
+    switch(opt){
+      case 'p': device=optarg; break;
+      case 'b': baud=atoi(optarg); break;
+      case 'n': address=optarg; break;
+      case 'c': nConn=atoi(optarg); break;
+      case 't': nThrottles=atoi(optarg); break;
+      case 'r': rate=atof(optarg); break;
+      case 'd': duration=atof(optarg); break;
+      case 'm': LoadGen::setMix(optarg); break;
+      case 'w': window=atoi(optarg); break;
+      case 'T':
+        LoadGen::turnouts.clear();
+        for(char *c=strtok(optarg,",");c!=NULL;c=strtok(NULL,","))
+          LoadGen::turnouts.push_back(atoi(c));
+        break;
+      case 'R': nRegs=atoi(optarg); break;
+      case 's': stallLimit=atof(optarg)/1000.0; break;
+      case 'x': timeout=atof(optarg)/1000.0; break;
+      case 'W': wait=atof(optarg)/1000.0; break;
+      case 'i': instrument=true; break;
+      case 'z': fuzz=true; break;
+      case 'j': cvs=optarg; break;
+      default: usage();
+    }
+  }
+
+  if((device==NULL)==(address==NULL) || nConn<1 || nThrottles<1 || rate<=0 || window<1 || nRegs<1 || LoadGen::turnouts.empty())
+    usage();
+  if(device!=NULL)
+    nConn=1;
+
+  for(int i=0;i<nConn;i++){
+    Conn c;
+    c.fd=(device!=NULL)?LoadGen::openSerial(device,baud):LoadGen::openTCP(address);
+    if(c.fd<0)
+      return(1);
+    c.lastRx=0;
+    c.writeBlocked=0;
+    LoadGen::conn.push_back(c);
+  }
+
+  if(wait<0)
+    wait=(device!=NULL)?2.0:0;          // opening the serial port of most Arduinos resets them
+  usleep((useconds_t)(wait*1e6));
+  for(size_t i=0;i<LoadGen::conn.size();i++){     // discard banner and anything else sent before the run
+    char buf[512];
+    while(read(LoadGen::conn[i].fd,buf,sizeof(buf))>0);
+  }
+
+  srand(1);
+
+  if(fuzz){
+    LoadGen::fuzz(duration,timeout);
+    return(0);
+  }
+
+  if(cvs!=NULL){
+    LoadGen::identify(cvs,std::max(timeout,30.0));      // a batch of many CVs takes many seconds on a build without roster hints
+    return(0);
+  }
+
+  start=LoadGen::now();
+  end=start+duration;
+
+  for(int i=0;i<nThrottles;i++){        // spread first request of each throttle evenly over one throttle period
+    Throttle th;
+    th.nReg=(i%nRegs)+1;
+    th.cab=i+3;
+    th.conn=i%nConn;
+    th.next=start+i/rate;
+    th.blocked=false;
+    LoadGen::throttle.push_back(th);
+  }
+
+  printf("LoadGen: %d throttles on %d connection(s), %.1f commands/s for %.1f s\n",nThrottles,nConn,rate,duration);
+
+  while((t=LoadGen::now())<end){
+    double next=end;
+
+    for(size_t i=0;i<LoadGen::throttle.size();i++){
+      Throttle &th=LoadGen::throttle[i];
+      while(th.next<=t && th.next<end){
+        if((int)LoadGen::conn[th.conn].pending.size()>=window){
+          if(!th.blocked)
+            LoadGen::nWindowFull++;
+          th.blocked=true;
+          break;
+        }
+        th.blocked=false;
+        LoadGen::send(th,t);
+        th.next+=nThrottles/rate;
+      }
+      if(!th.blocked)                   // a blocked throttle waits for a reply rather than a time
+        next=std::min(next,th.next);
+    }
+
+    std::vector<struct pollfd> p(LoadGen::conn.size());
+    for(size_t i=0;i<LoadGen::conn.size();i++){
+      LoadGen::flush(LoadGen::conn[i],t);
+      p[i].fd=LoadGen::conn[i].fd;
+      p[i].events=POLLIN|(LoadGen::conn[i].tx.empty()?0:POLLOUT);
+      p[i].revents=0;
+    }
+
+    poll(p.data(),p.size(),std::max(0,std::min(100,(int)((next-t)*1000.0))));
+
+    t=LoadGen::now();
+    for(size_t i=0;i<LoadGen::conn.size();i++){
+      if(p[i].revents&(POLLIN|POLLHUP|POLLERR))
+        LoadGen::receive(LoadGen::conn[i],t);
+      LoadGen::expire(LoadGen::conn[i],t,timeout);
+    }
+  }
+
+  for(t=LoadGen::now();t<end+timeout;t=LoadGen::now()){      // collect replies still outstanding
+    bool done=true;
+    std::vector<struct pollfd> p(LoadGen::conn.size());
+    for(size_t i=0;i<LoadGen::conn.size();i++){
+      LoadGen::flush(LoadGen::conn[i],t);
+      p[i].fd=LoadGen::conn[i].fd;
+      p[i].events=POLLIN;
+      p[i].revents=0;
+      done=done && LoadGen::conn[i].pending.empty();
+    }
+    if(done)
+      break;
+    poll(p.data(),p.size(),10);
+    t=LoadGen::now();
+    for(size_t i=0;i<LoadGen::conn.size();i++){
+      LoadGen::receive(LoadGen::conn[i],t);
+      LoadGen::expire(LoadGen::conn[i],t,timeout);
+    }
+  }
+
+  LoadGen::report(duration);
+
+  if(instrument){
+    printf("\nBASE STATION COUNTERS:\n");
+    LoadGen::query("<G>",0.5);
+    printf("BASE STATION SCHEDULE:\n");
+    LoadGen::query("<K>",0.5);
+    printf("BASE STATION HISTOGRAMS:\n");
+    LoadGen::query("<l>",0.5);
+  }
+
+  return(0);
+}
@@ -0,0 +1,197 @@
+/**********************************************************************
+
+Arduino.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+Minimal stand-in for the Arduino core, used only to compile modules of the sketch on a host computer for the
+programs in the tools folder.  It provides just enough of the Arduino types, helpers, and AVR registers for
+those modules.  Flash (PROGMEM) strings are ordinary strings, the AVR registers are plain variables, and the
+functions that would touch hardware are defined in Core.cpp, where they only check their arguments.
+
+Select the board being stood in for by defining ARDUINO_AVR_UNO or ARDUINO_AVR_MEGA2560 when compiling, just as
+the Arduino IDE does.  Note that int is 32 bits on the host, rather than 16 bits as on the AVR.
+
+**********************************************************************/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define DEC           10
+#define HEX           16
+
+#ifdef ARDUINO_AVR_UNO
+  #define NUM_DIGITAL_PINS  20
+  #define E2END             0x3FF
+  #define A0                14
+#else
+  #define NUM_DIGITAL_PINS  70
+  #define E2END             0xFFF
+  #define A0                54
+#endif
+
+#define A1  (A0+1)
+#define A2  (A0+2)
+#define A3  (A0+3)
+#define A4  (A0+4)
+#define A5  (A0+5)
+
+template<class T, class U> typename std::common_type<T,U>::type max(T a, U b){ return(a>b?a:b); }
+template<class T, class U> typename std::common_type<T,U>::type min(T a, U b){ return(a<b?a:b); }
+template<class T, class U, class V> T constrain(T x, U a, V b){ return(x<a?a:(x>b?b:x)); }
+
+#define lowByte(w)                    ((uint8_t)((w)&0xFF))
+#define highByte(w)                   ((uint8_t)((w)>>8))
+#define bit(b)                        (1UL<<(b))
+#define bitRead(value,bit)            (((value)>>(bit))&0x01)
+#define bitSet(value,bit)             ((value)|=(1UL<<(bit)))
+#define bitClear(value,bit)           ((value)&=~(1UL<<(bit)))
+#define bitWrite(value,bit,bitvalue)  ((bitvalue)?bitSet(value,bit):bitClear(value,bit))
+inline uint16_t word(uint8_t h, uint8_t l){ return((h<<8)|l); }
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define strlen_P            strlen
+#define strcpy_P            strcpy
+#define strncpy_P           strncpy
+#define strcmp_P            strcmp
+#define memcpy_P            memcpy
+#define sprintf_P           sprintf
+#define snprintf_P          snprintf
+#define sscanf_P            sscanf
+
+class __FlashStringHelper;
+#define F(s)                (reinterpret_cast<const __FlashStringHelper *>(s))
+
+void pinMode(uint8_t, uint8_t);
+void digitalWrite(uint8_t, uint8_t);
+int digitalRead(uint8_t);
+int analogRead(uint8_t);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long);
+void delayMicroseconds(unsigned int);
+
+extern volatile uint8_t SREG;
+inline void cli(){}
+inline void sei(){}
+#define noInterrupts()      cli()
+#define interrupts()        sei()
+#define ISR(vector)         extern "C" void vector()
+
+extern volatile uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B, TCCR3A, TCCR3B;
+extern volatile uint8_t TIMSK0, TIMSK1, TIMSK2, TIMSK3, TIFR2, TCNT0, TCNT2, OCR0A, OCR0B, CLKPR;
+extern volatile uint16_t OCR1A, OCR1B, OCR3A, OCR3B, TCNT1, TCNT3;
+
+#define WGM00   0                                 // bit numbers within the registers, as in <avr/io.h>
+#define WGM01   1
+#define WGM02   3
+#define WGM10   0
+#define WGM11   1
+#define WGM12   3
+#define WGM13   4
+#define WGM30   0
+#define WGM31   1
+#define WGM32   3
+#define WGM33   4
+#define COM0B0  4
+#define COM0B1  5
+#define COM1B0  4
+#define COM1B1  5
+#define COM3B0  4
+#define COM3B1  5
+#define CS00    0
+#define CS01    1
+#define CS02    2
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define CS20    0
+#define CS21    1
+#define CS22    2
+#define CS30    0
+#define CS31    1
+#define CS32    2
+#define OCIE0B  2
+#define OCIE1B  2
+#define OCIE3B  2
+#define TOIE2   0
+#define TOV2    0
+
+class Print;
+
+class Printable{
+  public:
+    virtual size_t printTo(Print &) const=0;
+};
+
+class Print{
+  public:
+    virtual size_t write(uint8_t)=0;
+    virtual size_t write(const uint8_t *, size_t);
+    size_t write(const char *s){ return(write((const uint8_t *)s,strlen(s))); }
+    virtual int availableForWrite(){ return(0); }
+    virtual void flush(){}
+    size_t print(const __FlashStringHelper *s){ return(write((const char *)s)); }
+    size_t print(const char *s){ return(write(s)); }
+    size_t print(char c){ return(write((uint8_t)c)); }
+    size_t print(unsigned char, int=DEC);
+    size_t print(int, int=DEC);
+    size_t print(unsigned int, int=DEC);
+    size_t print(long, int=DEC);
+    size_t print(unsigned long, int=DEC);
+    size_t print(double, int=2);
+    size_t print(const Printable &p){ return(p.printTo(*this)); }
+    size_t println(){ return(print("\r\n")); }
+    size_t println(const char *s){ return(print(s)+println()); }
+    size_t println(const __FlashStringHelper *s){ return(print(s)+println()); }
+    size_t println(int n, int base=DEC){ return(print(n,base)+println()); }
+    size_t println(long n, int base=DEC){ return(print(n,base)+println()); }
+    size_t println(unsigned long n, int base=DEC){ return(print(n,base)+println()); }
+};
+
+class Stream : public Print{
+  public:
+    virtual int available()=0;
+    virtual int read()=0;
+    virtual int peek()=0;
+};
+
+class HardwareSerial : public Stream{             // nothing is ever received, and everything written is passed to output (if set)
+  public:
+    void (*output)(uint8_t);
+    void begin(unsigned long){}
+    int available(){ return(0); }
+    int read(){ return(-1); }
+    int peek(){ return(-1); }
+    int availableForWrite(){ return(64); }
+    size_t write(uint8_t c){ if(output!=NULL) output(c); return(1); }
+    using Print::write;
+    operator bool(){ return(true); }
+};
+
+extern HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+#endif
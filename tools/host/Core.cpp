@@ -0,0 +1,96 @@
+/**********************************************************************
+
+Core.cpp
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+Definitions for the stand-in Arduino core (see Arduino.h and EEPROM.h).  Nothing here touches hardware: pins
+read as HIGH (digital) or 0 (analog), and writes to them are discarded.  Since the sketch only ever uses pins
+that exist on the board, any pin number of NUM_DIGITAL_PINS or more is reported and aborts the program --- on
+the AVR it would index past the end of the core's pin tables.
+
+**********************************************************************/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void checkPin(const char *f, uint8_t pin){
+  if(pin<NUM_DIGITAL_PINS)
+    return;
+  fprintf(stderr,"%s(%d): no such pin\n",f,pin);
+  abort();
+} // checkPin
+
+void pinMode(uint8_t pin, uint8_t){ checkPin("pinMode",pin); }
+void digitalWrite(uint8_t pin, uint8_t){ checkPin("digitalWrite",pin); }
+int digitalRead(uint8_t pin){ checkPin("digitalRead",pin); return(HIGH); }
+int analogRead(uint8_t pin){ checkPin("analogRead",pin<A0?pin+A0:pin); return(0); }
+
+unsigned long millis(){ return(0); }
+unsigned long micros(){ return(0); }
+void delay(unsigned long){}
+void delayMicroseconds(unsigned int){}
+
+///////////////////////////////////////////////////////////////////////////////
+
+volatile uint8_t SREG;
+volatile uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B, TCCR3A, TCCR3B;
+volatile uint8_t TIMSK0, TIMSK1, TIMSK2, TIMSK3, TIFR2, TCNT0, TCNT2, OCR0A, OCR0B, CLKPR;
+volatile uint16_t OCR1A, OCR1B, OCR3A, OCR3B, TCNT1, TCNT3;
+
+int __heap_start, *__brkval;
+
+HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+EEPROMClass EEPROM;
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Print::write(const uint8_t *b, size_t n){
+  for(size_t i=0;i<n;i++)
+    write(b[i]);
+  return(n);
+} // Print::write
+
+size_t Print::print(unsigned long n, int base){
+  char buf[8*sizeof(long)+1];
+  char *c=buf+sizeof(buf)-1;
+
+  *c='\0';
+  do{
+    *--c="0123456789ABCDEF"[n%base];
+    n/=base;
+  } while(n>0);
+  return(write(c));
+} // Print::print
+
+size_t Print::print(long n, int base){
+  if(n<0 && base==DEC)
+    return(print('-')+print(0UL-(unsigned long)n,base));
+  return(print((unsigned long)n,base));
+} // Print::print
+
+size_t Print::print(unsigned char n, int base){ return(print((unsigned long)n,base)); }
+size_t Print::print(int n, int base){ return(print((long)n,base)); }
+size_t Print::print(unsigned int n, int base){ return(print((unsigned long)n,base)); }
+
+size_t Print::print(double x, int digits){
+  char buf[32];
+  snprintf(buf,sizeof(buf),"%.*f",digits,x);
+  return(write(buf));
+} // Print::print
+
+///////////////////////////////////////////////////////////////////////////////
+
+void EEPROMClass::check(int a, int n){
+  if(a>=0 && a+n<=E2END+1)
+    return;
+  fprintf(stderr,"EEPROM access of %d bytes at %d is outside the EEPROM\n",n,a);
+  abort();
+} // EEPROMClass::check
@@ -0,0 +1,36 @@
+/**********************************************************************
+
+EEPROM.h
+COPYRIGHT (c) 2013-2016 Gregg E. Berman
+
+Part of DCC++ BASE STATION for the Arduino
+
+**********************************************************************/
+/**********************************************************************
+
+Minimal stand-in for the Arduino EEPROM library (see Arduino.h), holding the E2END+1 bytes of EEPROM in SRAM.
+Like a new board, every byte starts out erased (0xFF).  Any access outside the EEPROM is reported and aborts
+the program, rather than wrapping around as it would on the AVR.
+
+**********************************************************************/
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+struct EEPROMClass{
+  uint8_t mem[E2END+1];
+  EEPROMClass(){ memset(mem,0xFF,sizeof(mem)); }
+  static void check(int, int);
+  uint8_t read(int a){ check(a,1); return(mem[a]); }
+  void write(int a, uint8_t v){ check(a,1); mem[a]=v; }
+  void update(int a, uint8_t v){ write(a,v); }
+  uint16_t length(){ return(E2END+1); }
+  template<class T> T &get(int a, T &t){ check(a,sizeof(T)); memcpy(&t,mem+a,sizeof(T)); return(t); }
+  template<class T> const T &put(int a, const T &t){ check(a,sizeof(T)); memcpy(mem+a,&t,sizeof(T)); return(t); }
+}; // EEPROMClass
+
+extern EEPROMClass EEPROM;
+
+#endif